@@ -0,0 +1,49 @@
+#include <Arduino.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <json.hpp>
+using namespace io;
+using namespace json;
+// a small capture buffer and packed state, for running many readers at once
+using reader_t = json_reader_ex<64, json_compact_dialect>;
+static const char* docs[] = {
+    "{\"id\":1,\"temp\":21.5,\"ok\":true}",
+    "{\"id\":2,\"temp\":-4.25e1,\"ok\":false}",
+    "{\"id\":3,\"temp\":1.0e-2,\"ok\":true}",
+    "{\"id\":4,\"temp\":99,\"ok\":null}"
+};
+constexpr static const size_t doc_count = sizeof(docs) / sizeof(docs[0]);
+static const_buffer_stream* streams[doc_count];
+static reader_t* readers[doc_count];
+void setup() {
+    Serial.begin(115200);
+    Serial.printf("json_reader_ex<64>: %d bytes\r\n", (int)sizeof(json_reader_ex<64>));
+    Serial.printf("json_reader_ex<64, json_compact_dialect>: %d bytes\r\n", (int)sizeof(reader_t));
+    for(size_t i = 0; i < doc_count; ++i) {
+        streams[i] = new const_buffer_stream((const uint8_t*)docs[i], strlen(docs[i]));
+        readers[i] = new reader_t(*streams[i]);
+    }
+    // interleave the readers, one node at a time
+    bool more = true;
+    while(more) {
+        more = false;
+        for(size_t i = 0; i < doc_count; ++i) {
+            reader_t& reader = *readers[i];
+            if(!reader.read()) {
+                continue;
+            }
+            more = true;
+            if(reader.node_type() == json_node_type::field && 0 == strcmp("temp", reader.value()) && reader.read()) {
+                Serial.printf("sensor %d: %f\r\n", (int)i + 1, (float)reader.value_real());
+            }
+        }
+    }
+    for(size_t i = 0; i < doc_count; ++i) {
+        delete readers[i];
+        delete streams[i];
+    }
+}
+void loop() {
+}
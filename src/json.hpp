@@ -2,6 +2,8 @@
 #define HTCW_JSON_HPP
 #include <stddef.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <io_stream.hpp>
 #include <io_lex_source.hpp>
@@ -23,7 +25,7 @@ enum struct json_node_type {
 };
 
 /// @brief Indicates the typed value under the cursor, if any
-enum struct json_value_type {
+enum struct json_value_type : uint8_t {
     none = 0,
     null = 1,
     boolean = 2,
@@ -41,7 +43,61 @@ enum struct json_error {
     illegal_literal,
     illegal_character,
     field_too_long,
-    field_missing_value
+    field_missing_value,
+    nesting_too_deep,
+    illegal_encoding,
+    buffer_too_small
+};
+/// @brief Indicates how a reader treats strings
+enum struct json_strings {
+    /// @brief Chosen at runtime with raw_strings()
+    runtime = 0,
+    /// @brief Always dequoted and unescaped
+    decoded = 1,
+    /// @brief Always left quoted and escaped
+    raw = 2
+};
+/// @brief Indicates which grammar a reader accepts
+enum struct json_grammar {
+    /// @brief RFC 8259 JSON: values are separated by commas, and a document has a single root value
+    strict = 0,
+    /// @brief Also allows comments, trailing commas, NaN and Infinity
+    lenient = 1
+};
+/// @brief A policy that specializes json_reader_ex at compile time. Unused features compile to nothing.
+/// @tparam Strings How strings are treated
+/// @tparam Grammar The grammar that is accepted
+/// @tparam TypedNumbers True to convert numbers while lexing, false to convert them only when value_int() or value_real() is called
+/// @tparam MaxDepth The maximum nesting of arrays and objects combined, or 0 for the default. The strict grammar keeps a bit per level to match commas, fields and closing brackets to the open container, so its default is 256, or 64 when Compact. The lenient grammar has no limit by default.
+/// @tparam Compact True to pack the reader's state into the smallest fields, for running many readers in little RAM. Limits depth() to 65535 and position() to 4GB.
+template<json_strings Strings = json_strings::runtime, json_grammar Grammar = json_grammar::strict, bool TypedNumbers = true, unsigned int MaxDepth = 0, bool Compact = false>
+struct json_dialect {
+    constexpr static const json_strings strings = Strings;
+    constexpr static const json_grammar grammar = Grammar;
+    constexpr static const bool typed_numbers = TypedNumbers;
+    constexpr static const unsigned int max_depth = MaxDepth;
+    constexpr static const bool compact = Compact;
+};
+/// @brief A dialect for small devices, with packed reader state
+using json_compact_dialect = json_dialect<json_strings::runtime, json_grammar::strict, true, 0, true>;
+/// @brief A compact copy of one node, filled in by read_batch()
+struct json_node_record {
+    /// @brief The node type
+    json_node_type node_type;
+    /// @brief The typed value, if any
+    json_value_type value_type;
+    /// @brief The depth() after the node was read
+    unsigned int depth;
+    /// @brief The length of value in bytes, not including the terminator
+    unsigned int length;
+    /// @brief The string value in the arena passed to read_batch(), or nullptr for arrays, objects and their ends
+    const char* value;
+    union {
+        /// @brief The value for integer and boolean values
+        long long integer;
+        /// @brief The value for real values
+        double real;
+    };
 };
 namespace {
     // implement std::move to limit dependencies on the STL, which may not be there
@@ -52,6 +108,371 @@ namespace {
     typename remove_reference<T>::type&& member_move(T&& arg) {
         return static_cast<typename remove_reference<T>::type&&>(arg);
     }
+    template<bool Condition, typename T, typename F> struct json_conditional { typedef T type; };
+    template<typename T, typename F> struct json_conditional<false, T, F> { typedef F type; };
+    // scales by a power of ten without libm. the result is within a few ulps,
+    // and json_round_decimal() corrects it
+    inline double json_scale10(double value, int exponent) {
+        static const double powers[] = {1e1, 1e2, 1e4, 1e8, 1e16, 1e32, 1e64, 1e128};
+        if(value==0.0) {
+            return value;
+        }
+        bool negative = exponent<0;
+        unsigned int e = negative?-exponent:exponent;
+        // in steps, so subnormal results aren't flushed to zero
+        while(e>=256) {
+            value = negative?value/1e256:value*1e256;
+            e-=256;
+        }
+        double scale = 1.0;
+        for(int i = 0;e!=0;++i,e>>=1) {
+            if(e&1) {
+                scale*=powers[i];
+            }
+        }
+        return negative?value/scale:value*scale;
+    }
+    // an unsigned integer wide enough to compare a decimal of up to 100
+    // significant digits with the halfway point between two doubles
+    struct json_bigint {
+        uint32_t limbs[40];
+        size_t size;
+        void set(uint64_t value) {
+            size = 0;
+            while(value!=0) {
+                limbs[size++] = (uint32_t)value;
+                value>>=32;
+            }
+        }
+        void set(const json_bigint& rhs) {
+            // only the limbs in use
+            size = rhs.size;
+            memcpy(limbs,rhs.limbs,size*sizeof(uint32_t));
+        }
+        void mul_add(uint32_t factor, uint32_t addend) {
+            uint64_t carry = addend;
+            for(size_t i = 0;i<size;++i) {
+                carry+=(uint64_t)limbs[i]*factor;
+                limbs[i] = (uint32_t)carry;
+                carry>>=32;
+            }
+            if(carry!=0 && size<40) {
+                limbs[size++] = (uint32_t)carry;
+            }
+        }
+        void mul_pow5(unsigned int exponent) {
+            static const uint32_t powers[] = {1,5,25,125,625,3125,15625,78125,390625,1953125,9765625,48828125,244140625,1220703125};
+            while(exponent>=13) {
+                mul_add(powers[13],0);
+                exponent-=13;
+            }
+            mul_add(powers[exponent],0);
+        }
+        void shift_left(unsigned int bits) {
+            if(size==0) {
+                return;
+            }
+            size_t words = bits/32;
+            bits%=32;
+            if(bits!=0) {
+                uint32_t carry = 0;
+                for(size_t i = 0;i<size;++i) {
+                    uint32_t limb = limbs[i];
+                    limbs[i] = (limb<<bits)|carry;
+                    carry = limb>>(32-bits);
+                }
+                if(carry!=0) {
+                    limbs[size++] = carry;
+                }
+            }
+            if(words!=0) {
+                memmove(limbs+words,limbs,size*sizeof(uint32_t));
+                memset(limbs,0,words*sizeof(uint32_t));
+                size+=words;
+            }
+        }
+        int compare(const json_bigint& rhs) const {
+            if(size!=rhs.size) {
+                return size<rhs.size?-1:1;
+            }
+            for(size_t i = size;i>0;--i) {
+                if(limbs[i-1]!=rhs.limbs[i-1]) {
+                    return limbs[i-1]<rhs.limbs[i-1]?-1:1;
+                }
+            }
+            return 0;
+        }
+        // rhs must not be larger
+        void subtract(const json_bigint& rhs) {
+            uint64_t borrow = 0;
+            for(size_t i = 0;i<size;++i) {
+                uint64_t difference = (uint64_t)limbs[i]-(i<rhs.size?rhs.limbs[i]:0)-borrow;
+                limbs[i] = (uint32_t)difference;
+                borrow = (difference>>32)!=0;
+            }
+            while(size>0 && limbs[size-1]==0) {
+                --size;
+            }
+        }
+    };
+    // compares (digits+tail)*10^exponent with halfway*2^binary_exponent, where
+    // tail is the fraction of a last digit made by any dropped digits. 10^n is
+    // 5^n*2^n, so only the powers of five need multiplying out. without the
+    // text of the dropped digits, *ambiguous is set if they would decide
+    inline int json_compare_halfway(const json_bigint& digits, int exponent, bool sticky, const char* tail, size_t tail_size, uint64_t halfway, int binary_exponent, bool* ambiguous) {
+        json_bigint lhs;
+        json_bigint rhs;
+        lhs.set(digits);
+        rhs.set(halfway);
+        if(exponent>=0) {
+            lhs.mul_pow5(exponent);
+        } else {
+            rhs.mul_pow5(-exponent);
+        }
+        if(binary_exponent>=exponent) {
+            rhs.shift_left(binary_exponent-exponent);
+        } else {
+            lhs.shift_left(exponent-binary_exponent);
+        }
+        int result = lhs.compare(rhs);
+        if(!sticky || result>=0) {
+            // dropped digits are all nonzero, so they tip a tie upward
+            return sticky?1:result;
+        }
+        // the value of one in the last digit, scaled the same way
+        json_bigint unit;
+        unit.set(1);
+        if(exponent>=0) {
+            unit.mul_pow5(exponent);
+        }
+        if(binary_exponent<exponent) {
+            unit.shift_left(exponent-binary_exponent);
+        }
+        rhs.subtract(lhs);
+        if(rhs.compare(unit)>=0) {
+            // halfway is past the last digit plus one
+            return -1;
+        }
+        if(tail==nullptr) {
+            *ambiguous = true;
+            return -1;
+        }
+        // compare the dropped digits with the digits of the remainder
+        for(size_t i = 0;i<tail_size;++i) {
+            if(tail[i]<'0' || tail[i]>'9') {
+                continue;
+            }
+            rhs.mul_add(10,0);
+            int digit = 0;
+            while(rhs.compare(unit)>=0) {
+                rhs.subtract(unit);
+                ++digit;
+            }
+            if(tail[i]-'0'!=digit) {
+                return tail[i]-'0'>digit?1:-1;
+            }
+        }
+        return rhs.size==0?0:-1;
+    }
+    // moves an estimate within a few ulps of the decimal to the nearest
+    // double, ties to even
+    inline double json_round_decimal(const json_bigint& digits, int exponent, bool sticky, const char* tail, size_t tail_size, double estimate, bool* ambiguous) {
+        *ambiguous = false;
+        if(!(estimate<=1.7976931348623157e308)) {
+            estimate = 1.7976931348623157e308;
+        }
+        uint64_t bits;
+        memcpy(&bits,&estimate,sizeof(bits));
+        if(bits==0) {
+            bits = 1;
+        }
+        while(true) {
+            int biased = (int)(bits>>52);
+            uint64_t fraction = bits&((((uint64_t)1)<<52)-1);
+            // the double below is half as far away at a power of two
+            bool boundary = fraction==0 && biased>1;
+            int binary_exponent = -1074;
+            if(biased!=0) {
+                fraction|=((uint64_t)1)<<52;
+                binary_exponent = biased-1075;
+            }
+            bool odd = (fraction&1)!=0;
+            int cmp = json_compare_halfway(digits,exponent,sticky,tail,tail_size,2*fraction+1,binary_exponent-1,ambiguous);
+            if(cmp>0 || (cmp==0 && odd)) {
+                // up, possibly to infinity
+                if(++bits==0x7FF0000000000000ULL) {
+                    break;
+                }
+                continue;
+            }
+            cmp = boundary?json_compare_halfway(digits,exponent,sticky,tail,tail_size,4*fraction-1,binary_exponent-2,ambiguous):
+                json_compare_halfway(digits,exponent,sticky,tail,tail_size,2*fraction-1,binary_exponent-1,ambiguous);
+            if(cmp<0 || (cmp==0 && odd)) {
+                // down, possibly to zero
+                if(--bits==0) {
+                    break;
+                }
+                continue;
+            }
+            break;
+        }
+        double result;
+        memcpy(&result,&bits,sizeof(result));
+        return result;
+    }
+    // mantissa*10^exponent correctly rounded. sticky means nonzero digits
+    // were dropped after the mantissa. if they would decide the rounding,
+    // *ambiguous is set and the result assumes they're negligible
+    inline double json_decimal_to_double(uint64_t mantissa, int exponent, bool sticky, bool* ambiguous) {
+        static const double powers[] = {1e0,1e1,1e2,1e3,1e4,1e5,1e6,1e7,1e8,1e9,1e10,1e11,1e12,1e13,1e14,1e15,1e16,1e17,1e18,1e19,1e20,1e21,1e22};
+        *ambiguous = false;
+        if(mantissa==0) {
+            return 0.0;
+        }
+        if(!sticky && mantissa<=(((uint64_t)1)<<53) && exponent>=-22 && exponent<=22) {
+            // both are exact, so this rounds once (Clinger's fast path)
+            return exponent<0?(double)mantissa/powers[-exponent]:(double)mantissa*powers[exponent];
+        }
+        int digits = 0;
+        for(uint64_t m = mantissa;m!=0;m/=10) {
+            ++digits;
+        }
+        if(digits+exponent>310) {
+            return INFINITY;
+        }
+        if(digits+exponent<-324) {
+            // below half the smallest subnormal
+            return 0.0;
+        }
+        json_bigint big;
+        big.set(mantissa);
+        return json_round_decimal(big,exponent,sticky,nullptr,0,json_scale10((double)mantissa,exponent),ambiguous);
+    }
+    // the same, from the text of a number. used when the digits
+    // json_decimal_to_double() was given weren't enough to decide
+    inline double json_decimal_to_double(const char* text, size_t size, int exponent, double estimate) {
+        json_bigint big;
+        big.set(0);
+        int kept = 0;
+        bool point = false;
+        size_t i = 0;
+        for(;i<size && kept<100 && text[i]!='e' && text[i]!='E';++i) {
+            if(text[i]=='.') {
+                point = true;
+                continue;
+            }
+            if(text[i]<'0' || text[i]>'9') {
+                continue;
+            }
+            if(kept==0 && text[i]=='0') {
+                if(point) {
+                    --exponent;
+                }
+                continue;
+            }
+            big.mul_add(10,(uint32_t)(text[i]-'0'));
+            ++kept;
+            if(point) {
+                --exponent;
+            }
+        }
+        // the rest of the digits only move the point
+        const char* tail = text+i;
+        size_t tail_size = 0;
+        bool sticky = false;
+        for(;i<size && text[i]!='e' && text[i]!='E';++i,++tail_size) {
+            if(text[i]=='.') {
+                point = true;
+            } else {
+                sticky = sticky || text[i]!='0';
+                if(!point) {
+                    ++exponent;
+                }
+            }
+        }
+        if(kept==0) {
+            return 0.0;
+        }
+        bool ambiguous;
+        return json_round_decimal(big,exponent,sticky,tail,tail_size,estimate,&ambiguous);
+    }
+    // the value of the text of a valid JSON number, rounded the same way
+    // the reader rounds it, for tools that hold the whole number as text
+    inline double json_number_to_double(const char* text, size_t size) {
+        size_t i = 0;
+        bool neg = size!=0 && text[0]=='-';
+        if(neg) {
+            ++i;
+        }
+        // the same mantissa the reader keeps
+        uint64_t mantissa = 0;
+        int scale = 0;
+        bool sticky = false;
+        bool fraction = false;
+        for(;i<size && text[i]!='e' && text[i]!='E';++i) {
+            if(text[i]=='.') {
+                fraction = true;
+                continue;
+            }
+            int digit = text[i]-'0';
+            if(mantissa<922337203685477580ULL || (mantissa==922337203685477580ULL && digit<=7)) {
+                mantissa = mantissa*10+digit;
+                if(fraction) {
+                    --scale;
+                }
+            } else {
+                if(digit!=0) {
+                    sticky = true;
+                }
+                if(!fraction && scale<0x7FFF) {
+                    ++scale;
+                }
+            }
+        }
+        int exponent = 0;
+        if(i<size) {
+            ++i;
+            bool exp_neg = i<size && text[i]=='-';
+            if(i<size && (text[i]=='-' || text[i]=='+')) {
+                ++i;
+            }
+            for(;i<size;++i) {
+                if(exponent<0x7FFF) {
+                    exponent = exponent*10+(text[i]-'0');
+                }
+            }
+            if(exp_neg) {
+                exponent = -exponent;
+            }
+        }
+        bool ambiguous;
+        double value = json_decimal_to_double(mantissa,exponent+scale,sticky,&ambiguous);
+        if(ambiguous) {
+            value = json_decimal_to_double(text,size,exponent,value);
+        }
+        return neg?-value:value;
+    }
+    // the value of the text of a valid JSON integer. false if it doesn't
+    // fit in a long long
+    inline bool json_number_to_int(const char* text, size_t size, long long* value) {
+        size_t i = 0;
+        bool neg = size!=0 && text[0]=='-';
+        if(neg) {
+            ++i;
+        }
+        // one more for the magnitude of the most negative value
+        const unsigned long long limit = 9223372036854775807ULL+(neg?1:0);
+        unsigned long long result = 0;
+        for(;i<size;++i) {
+            unsigned int digit = (unsigned int)(text[i]-'0');
+            if(digit>9 || result>(limit-digit)/10) {
+                return false;
+            }
+            result = result*10+digit;
+        }
+        *value = neg?-(long long)(result-1)-1:(long long)result;
+        return true;
+    }
 }
 /// @brief A common interface for any JSON reader
 class json_reader_base {
@@ -80,6 +501,11 @@ public:
     /// @brief Indicates whether or not the node type is a value, value_part, or end_value_part
     /// @return True if it's a value, otherwise false
     virtual bool is_value() const=0;
+    /// @brief Indicates whether or not the value under the cursor is a string. Unlike value_type(), this is already known at the first value_part.
+    /// @return True if it's a string, otherwise false
+    virtual bool is_string() const {
+        return is_value() && value_type()==json_value_type::none;
+    }
     /// @brief Indicates whether or not strings are escaped and dequoted
     /// @return True if not escaped and dequoted, otherwise false
     virtual bool raw_strings() const=0;
@@ -92,54 +518,273 @@ public:
     /// @brief Reads the next element
     /// @return True if successful, otherwise error or no more data
     virtual bool read()=0;
+    /// @brief Skips the value under the cursor, or the value of the field under the cursor, including any children
+    /// @details Afterward the cursor is on the last node of the value, such as end_array, end_object or end_value_part, so the next read() moves past it
+    /// @return True if successful, otherwise false
+    virtual bool skip_value() {
+        switch(node_type()) {
+            case json_node_type::field:
+                if(!read()) {
+                    return false;
+                }
+                return skip_value();
+            case json_node_type::array:
+            case json_node_type::object: {
+                int nesting = 1;
+                while(nesting>0 && read()) {
+                    switch(node_type()) {
+                        case json_node_type::array:
+                        case json_node_type::object:
+                            ++nesting;
+                            break;
+                        case json_node_type::end_array:
+                        case json_node_type::end_object:
+                            --nesting;
+                            break;
+                        default:
+                            break;
+                    }
+                }
+                return nesting==0;
+            }
+            case json_node_type::value_part:
+                while(read() && node_type()==json_node_type::value_part);
+                return node_type()==json_node_type::end_value_part;
+            case json_node_type::value:
+            case json_node_type::end_value_part:
+            case json_node_type::end_array:
+            case json_node_type::end_object:
+                return true;
+            default:
+                return false;
+        }
+    }
+};
+/// @brief The kinds of the open containers, one bit per level, set for objects. Used by json_reader_ex for the strict grammar.
+/// @tparam Depth The number of levels, or 0 to keep nothing
+template<unsigned int Depth>
+class json_kind_stack {
+    uint8_t m_kinds[(Depth+7)/8];
+protected:
+    void kinds_clear() {
+        memset(m_kinds,0,sizeof(m_kinds));
+    }
+    void kinds_copy(const json_kind_stack& rhs) {
+        memcpy(m_kinds,rhs.m_kinds,sizeof(m_kinds));
+    }
+    void kind(unsigned int level, bool object) {
+        uint8_t bit = (uint8_t)(1<<(level&7));
+        if(object) {
+            m_kinds[level>>3] |= bit;
+        } else {
+            m_kinds[level>>3] &= (uint8_t)~bit;
+        }
+    }
+    bool kind(unsigned int level) const {
+        return 0!=(m_kinds[level>>3]&(1<<(level&7)));
+    }
+};
+// empty, so it takes no room in the reader
+template<>
+class json_kind_stack<0> {
+protected:
+    void kinds_clear() {
+    }
+    void kinds_copy(const json_kind_stack&) {
+    }
+    void kind(unsigned int, bool) {
+    }
+    bool kind(unsigned int) const {
+        return false;
+    }
 };
-template<size_t CaptureSize=1024>
-class json_reader_ex : public json_reader_base {
+/// @brief A JSON pull parser over a stream
+/// @tparam CaptureSize The size of the capture buffer
+/// @tparam Dialect A json_dialect<> (or compatible policy) that specializes the reader
+template<size_t CaptureSize=1024, typename Dialect=json_dialect<>>
+class json_reader_ex : public json_reader_base, private json_kind_stack<Dialect::grammar!=json_grammar::strict?0:Dialect::max_depth!=0?Dialect::max_depth:Dialect::compact?64:256> {
 public:
     constexpr static const size_t capture_size = CaptureSize;
+    using dialect_type = Dialect;
 private:
     using ls_type = io::lex_source<CaptureSize>;
+    // compact dialects get the narrowest field that holds each value
+    using small_type = typename json_conditional<Dialect::compact, int8_t, int>::type;
+    using depth_type = typename json_conditional<Dialect::compact, uint16_t, unsigned int>::type;
+    using sub_type = typename json_conditional<Dialect::compact, uint16_t, int>::type;
+    using accum_type = typename json_conditional<Dialect::compact, uint16_t, int32_t>::type;
+    using position_type = typename json_conditional<Dialect::compact, uint32_t, unsigned long long>::type;
+    // the strict grammar keeps a bit per open container
+    constexpr static const unsigned int kind_depth = Dialect::grammar!=json_grammar::strict?0:Dialect::max_depth!=0?Dialect::max_depth:Dialect::compact?64:256;
+    using kinds_type = json_kind_stack<kind_depth>;
+    constexpr static const unsigned int depth_limit = Dialect::max_depth!=0?Dialect::max_depth:kind_depth!=0?kind_depth:Dialect::compact?0xFFFF:0;
+    // the largest mantissa that can take another digit
+    constexpr static const long long mantissa_limit = 922337203685477580LL;
     ls_type m_source;
-    int m_state;
-    unsigned int m_depth;
-    int m_error;
-    int m_lex_state;
-    bool m_lex_neg;
-    int m_lex_sub;
-    int32_t m_lex_accum;
-    double m_real;
-    long long m_int;
+    // only one is valid, according to m_value_type
+    union {
+        double m_real;
+        long long m_int;
+    };
+    position_type m_position;
+    position_type m_node_position;
+    depth_type m_depth;
+    // open arrays and objects together
+    depth_type m_nesting;
+    // the number's decimal exponent, or the code point of a \u escape
+    accum_type m_lex_accum;
+    // the number's phase, the expected keyword character, or a pending high surrogate
+    sub_type m_lex_sub;
+    small_type m_state;
+    small_type m_error;
+    small_type m_lex_state;
+    // where the decimal point goes relative to the mantissa
+    int16_t m_lex_scale;
     json_value_type m_value_type;
-    bool m_raw_strings;
+    // the flags share a byte
+    bool m_lex_neg : 1;
+    bool m_raw_strings : 1;
+    // set() resumed in the middle of a document, so closers of containers
+    // that were opened before the resume point are expected
+    bool m_resumed : 1;
+    // nonzero digits past what the mantissa holds were dropped
+    bool m_lex_sticky : 1;
     void do_move(json_reader_ex& rhs) {
+        if(this==&rhs) {
+            return;
+        }
         m_source = member_move(rhs.m_source);
         m_state = rhs.m_state;
-        rhs.m_state = (int)json_node_type::initial;
         m_depth = rhs.m_depth;
-        rhs.m_depth = 0;
+        m_nesting = rhs.m_nesting;
+        m_resumed = rhs.m_resumed;
         m_error = rhs.m_error;
-        rhs.m_error = 0;
         m_lex_state = rhs.m_lex_state;
-        m_lex_neg = rhs.m_lex_state;
+        m_lex_neg = rhs.m_lex_neg;
+        m_lex_sticky = rhs.m_lex_sticky;
         m_lex_sub = rhs.m_lex_sub;
         m_lex_accum = rhs.m_lex_accum;
+        m_lex_scale = rhs.m_lex_scale;
+        m_int = rhs.m_int;
         m_value_type = rhs.m_value_type;
         m_raw_strings = rhs.m_raw_strings;
+        m_position = rhs.m_position;
+        m_node_position = rhs.m_node_position;
+        kinds_type::kinds_copy(rhs);
+        // leave rhs as though it was default constructed
+        rhs.reset_fields();
+        rhs.m_state = (int)json_node_type::error;
+        rhs.m_error = -1;
+    }
+    void reset_fields() {
+        m_state = (int)json_node_type::initial;
+        m_depth = 0;
+        m_nesting = 0;
+        m_resumed = false;
+        m_error = 0;
+        m_lex_state = 0;
+        m_lex_neg = false;
+        m_lex_sticky = false;
+        m_lex_sub = 0;
+        m_lex_accum = 0;
+        m_lex_scale = 0;
+        m_int = 0;
+        m_value_type = json_value_type::none;
+        m_raw_strings = false;
+        m_position = 0;
+        m_node_position = 0;
+        kinds_type::kinds_clear();
     }
     json_reader_ex(const json_reader_ex& rhs)=delete;
     json_reader_ex& operator=(const json_reader_ex& rhs)=delete;
+    bool advance() {
+        if(m_source.more()) {
+            ++m_position;
+        }
+        return m_source.advance();
+    }
+    bool is_raw() const {
+        return Dialect::strings==json_strings::runtime?m_raw_strings:Dialect::strings==json_strings::raw;
+    }
+    bool open_nesting(bool object) {
+        if(depth_limit!=0 && m_nesting>=depth_limit) {
+            m_error = (int)json_error::nesting_too_deep;
+            return false;
+        }
+        kinds_type::kind(m_nesting,object);
+        ++m_nesting;
+        return true;
+    }
+    // whether the kind of the innermost container is known. a resumed
+    // reader doesn't know the containers around the resume point
+    bool kind_known() const {
+        return kind_depth!=0 && m_nesting!=0 && !m_resumed;
+    }
+    bool in_object() const {
+        return kinds_type::kind(m_nesting-1);
+    }
+    // balances a closing bracket. fails if nothing is open, or in the
+    // strict grammar, if the bracket doesn't match the open container
+    bool close_nesting(bool object) {
+        if(m_nesting==0) {
+            if(m_resumed) {
+                return true;
+            }
+            m_error = (int)json_error::illegal_character;
+            return false;
+        }
+        if(kind_known() && in_object()!=object) {
+            m_error = (int)json_error::illegal_character;
+            return false;
+        }
+        --m_nesting;
+        return true;
+    }
+    void skip_comment() {
+        // current is '/'
+        if(!advance()) {
+            m_error = (int)json_error::unterminated_element;
+            return;
+        }
+        if(m_source.current()=='/') {
+            while(advance() && m_source.current()!='\n');
+            return;
+        }
+        if(m_source.current()=='*') {
+            bool star = false;
+            while(advance()) {
+                if(star && m_source.current()=='/') {
+                    advance();
+                    return;
+                }
+                star = m_source.current()=='*';
+            }
+            m_error = (int)json_error::unterminated_element;
+            return;
+        }
+        m_error = (int)json_error::illegal_character;
+    }
     void skip_whitespace() {
-        while(m_source.current()==' ' || m_source.current()=='\r' || m_source.current()=='\v' ||
-                m_source.current()=='\t' || m_source.current()=='\n') {
-            if(!m_source.advance()) {
-                break;
+        while(true) {
+            while(m_source.current()==' ' || m_source.current()=='\r' || m_source.current()=='\v' ||
+                    m_source.current()=='\t' || m_source.current()=='\n') {
+                if(!advance()) {
+                    return;
+                }
+            }
+            if(Dialect::grammar!=json_grammar::lenient || m_source.current()!='/') {
+                return;
+            }
+            skip_comment();
+            if(m_error!=0) {
+                return;
             }
         }
     }
     static uint8_t from_hex_char(int32_t hex) {
-        if (':' > hex && '/' < hex)
+        if(':' > hex && '/' < hex)
             return (uint8_t)(hex - '0');
-        if ('G' > hex && '@' < hex)
+        if('G' > hex && '@' < hex)
             return (uint8_t)(hex - '7'); // 'A'-10
         return (uint8_t)(hex - 'W'); // 'a'-10
     }
@@ -148,34 +793,75 @@ private:
             ('G' > hex && '@' < hex) ||
             ('g' > hex && '`' < hex);
     }
+    // numbers accumulate an exact integer mantissa in m_int and a decimal
+    // point offset in m_lex_scale, then convert once at the end
+    void number_digit(int digit, bool fraction) {
+        if(m_int<mantissa_limit || (m_int==mantissa_limit && digit<=7)) {
+            m_int = m_int*10+digit;
+            if(fraction) {
+                --m_lex_scale;
+            }
+        } else {
+            // too many digits to keep. the rest only move the point
+            if(digit!=0) {
+                m_lex_sticky = true;
+            }
+            if(!fraction && m_lex_scale<0x7FFF) {
+                ++m_lex_scale;
+            }
+        }
+    }
+    void number_end(bool real) {
+        if(!real && m_lex_scale==0) {
+            if(m_lex_neg) {
+                m_int = -m_int;
+            }
+            m_value_type = json_value_type::integer;
+            return;
+        }
+        int exponent = m_lex_sub==3?-(int)m_lex_accum:(int)m_lex_accum;
+        bool ambiguous;
+        double value = json_decimal_to_double((uint64_t)m_int,exponent+m_lex_scale,m_lex_sticky,&ambiguous);
+        if(ambiguous && m_state!=(int)json_node_type::value_part) {
+            // not split, so all of the digits are still in the capture
+            value = json_decimal_to_double(m_source.const_capture_buffer(),m_source.capture_size(),exponent,value);
+        }
+        m_real = m_lex_neg?-value:value;
+        m_value_type = json_value_type::real;
+    }
     bool lex_number() {
+        if(Dialect::grammar==json_grammar::lenient && m_lex_state>=40) {
+            return lex_keyword();
+        }
         switch(m_lex_state) {
             case 0:
                 m_lex_neg = false;
+                m_lex_sticky = false;
                 m_lex_sub = 0;
                 m_lex_accum = 0;
-                m_real = 0.0;
+                m_lex_scale = 0;
                 m_int = 0;
                 m_value_type = json_value_type::integer;
                 if(m_source.current()=='0') {
                     m_source.capture(m_source.current());
-                    m_source.advance();
+                    advance();
                     m_lex_state = 2;
                     return true;
                 }
                 if(m_source.current()=='-') {
                     m_source.capture(m_source.current());
-                    m_source.advance();
+                    advance();
                     m_lex_neg = true;
                     m_lex_state = 1;
                     return true;
                 }
                 if(m_source.current()>='1' && m_source.current()<='9') {
-                    m_int=m_source.current()-'0';
+                    if(Dialect::typed_numbers) {
+                        m_int=m_source.current()-'0';
+                    }
                     m_source.capture(m_source.current());
-                    m_source.advance();
+                    advance();
                     m_lex_state = 8;
-                    m_real = m_int;
                     return true;
                 }
                 m_error = (int)json_error::illegal_literal;
@@ -183,99 +869,91 @@ private:
             case 1:
                 if(m_source.current()=='0') {
                     m_source.capture(m_source.current());
-                    m_source.advance();
+                    advance();
                     m_lex_state = 2;
                     return true;
                 }
                 if(m_source.current()>='1' && m_source.current()<='9') {
-                    m_int=m_source.current()-'0';
+                    if(Dialect::typed_numbers) {
+                        m_int=m_source.current()-'0';
+                    }
                     m_source.capture(m_source.current());
-                    m_source.advance();
+                    advance();
                     m_lex_state = 8;
-                    m_real = m_int;
+                    return true;
+                }
+                if(Dialect::grammar==json_grammar::lenient && m_source.current()=='I') {
+                    // -Infinity
+                    m_lex_accum = 1;
+                    m_lex_sub = 0;
+                    m_lex_state = 40;
                     return true;
                 }
                 m_error = (int)json_error::illegal_literal;
                 return false;
             case 2:
-                if(m_source.current()>='0' && m_source.current()<='9') {
-                    m_int=m_source.current()-'0';
+                // only lenient allows leading zeros
+                if(Dialect::grammar==json_grammar::lenient && m_source.current()>='0' && m_source.current()<='9') {
+                    if(Dialect::typed_numbers) {
+                        m_int=m_source.current()-'0';
+                    }
                     m_source.capture(m_source.current());
-                    m_source.advance();
+                    advance();
                     m_lex_state = 4;
-                    m_real = m_int;
                     return true;
                 }
                 if(m_source.current()=='.') {
                     m_source.capture(m_source.current());
-                    m_source.advance();
+                    advance();
                     m_lex_state = 3;
                     m_lex_sub = 1; // frac part
                     return true;
                 }
                 if(m_source.current()=='E' || m_source.current()=='e') {
                     m_source.capture(m_source.current());
-                    m_source.advance();
+                    advance();
                     m_lex_state = 5;
                     m_lex_sub = 2;
                     return true;
                 }
-                if(m_lex_neg) {
-                    m_real*=-1;
-                    m_int*=-1;
+                if(Dialect::typed_numbers) {
+                    number_end(false);
                 }
                 // is already int
                 // no more data
                 return false;
             case 3:
                 if(m_source.current()>='0' && m_source.current()<='9') {
-                    double f = m_source.current()-'0';
+                    if(Dialect::typed_numbers) {
+                        number_digit(m_source.current()-'0',true);
+                    }
                     m_source.capture(m_source.current());
-                    m_source.advance();
+                    advance();
                     m_lex_state = 4;
-                    int i = m_lex_accum+1;
-                    while(i--) {
-                        f*=.1;
-                    }
-                    ++m_lex_accum;
-                    m_real+=f;
                     return true;
                 }
                 m_error = (int)json_error::illegal_literal;
                 return false;
             case 4:
                 if(m_source.current()>='0' && m_source.current()<='9') {
-                    if(m_lex_sub==1) {
-                        double f = m_source.current()-'0';
-                        int i = m_lex_accum+1;
-                        while(i--) {
-                            f*=.1;
-                        }
-                        ++m_lex_accum;
-                        m_real+=f;
-                    } else {
-                        m_int*=10;
-                        m_int += (m_source.current()-'0');
-                        m_real = m_int;
+                    if(Dialect::typed_numbers) {
+                        number_digit(m_source.current()-'0',m_lex_sub==1);
                     }
                     m_source.capture(m_source.current());
-                    m_source.advance();
+                    advance();
                     m_lex_state = 4;
                     return true;
                 }
                 if(m_source.current()=='E' || m_source.current()=='e') {
                     m_source.capture(m_source.current());
-                    m_source.advance();
+                    advance();
                     m_lex_state = 5;
                     m_lex_sub = 2;
-                    m_lex_accum = 0;
                     return true;
                 }
-                if(m_lex_neg) {
-                    m_real*=-1;
-                    m_int*=-1;
-                }
-                if(m_lex_sub==0) {
+                if(Dialect::typed_numbers) {
+                    number_end(m_lex_sub!=0);
+                } else if(m_lex_sub==0) {
                     m_value_type = json_value_type::integer;
                 } else {
                     m_value_type = json_value_type::real;
@@ -286,17 +964,21 @@ private:
                     m_lex_accum*=10;
                     m_lex_accum += (m_source.current()-'0');
                     m_source.capture(m_source.current());
-                    m_source.advance();
+                    advance();
                     m_lex_state = 7;
                     
                     return true;
                 }
                 if(m_source.current()=='-') {
+                    m_source.capture(m_source.current());
+                    advance();
                     m_lex_state = 6;
                     m_lex_sub = 3;
                     return true;
                 }
                 if(m_source.current()=='+') {
+                    m_source.capture(m_source.current());
+                    advance();
                     m_lex_state = 6;
                     return true;
                 }
@@ -307,7 +989,7 @@ private:
                     m_lex_accum*=10;
                     m_lex_accum += (m_source.current()-'0');
                     m_source.capture(m_source.current());
-                    m_source.advance();
+                    advance();
                     m_lex_state = 7;
                     return true;
                 }
@@ -315,49 +997,49 @@ private:
                 return false;
             case 7:
                 if(m_source.current()>='0' && m_source.current()<='9') {
-                    m_lex_accum*=10;
-                    m_lex_accum += (m_source.current()-'0');
+                    if(m_lex_accum<1000) { // don't overflow on silly exponents
+                        m_lex_accum*=10;
+                        m_lex_accum += (m_source.current()-'0');
+                    }
                     m_source.capture(m_source.current());
-                    m_source.advance();
+                    advance();
                     m_lex_state = 7;
                     return true;
                 }
-                m_real*=pow(10,m_lex_accum);
-                m_int*=pow(10,m_lex_accum);
-                if(m_lex_neg) {
-                    m_real*=-1;
-                    m_int*=-1;
+                if(Dialect::typed_numbers) {
+                    number_end(true);
+                } else {
+                    m_value_type = json_value_type::real;
                 }
-                m_value_type = json_value_type::real;
                 return false;
             case 8:
                 if(m_source.current()>='0' && m_source.current()<='9') {
-                    m_int*=10;
-                    m_int += (m_source.current()-'0');
+                    if(Dialect::typed_numbers) {
+                        number_digit(m_source.current()-'0',false);
+                    }
                     m_source.capture(m_source.current());
-                    m_source.advance();
+                    advance();
                     m_lex_state = 8;
-                    m_real = m_int;
                     return true;
                 }
                 if(m_source.current()=='.') {
                     m_source.capture(m_source.current());
-                    m_source.advance();
+                    advance();
                     m_lex_sub=1;
                     m_lex_state = 3;
                     return true;
                 }
                 if(m_source.current()=='E' || m_source.current()=='e') {
                     m_source.capture(m_source.current());
-                    m_source.advance();
+                    advance();
                     m_lex_state = 5;
                     return true;
                 }
-                if(m_lex_neg) {
-                    m_real*=-1;
-                    m_int*=-1;
+                if(Dialect::typed_numbers) {
+                    number_end(false);
+                } else {
+                    m_value_type = json_value_type::integer;
                 }
-                m_value_type = json_value_type::real;
                 return false;
             default:
                 m_error = (int)json_error::illegal_literal;
@@ -365,19 +1047,41 @@ private:
         }
         
     }
+    // lenient only: NaN (m_lex_accum=0) and Infinity (m_lex_accum=1)
+    // m_lex_sub is the index of the next expected character
+    bool lex_keyword() {
+        const char* kw = m_lex_accum==0?"NaN":"Infinity";
+        if(kw[m_lex_sub]==0) {
+            m_value_type = json_value_type::real;
+            if(m_lex_accum==0) {
+                m_real = NAN;
+            } else {
+                m_real = m_lex_neg?-INFINITY:INFINITY;
+            }
+            return false;
+        }
+        if(m_source.current()==kw[m_lex_sub]) {
+            m_source.capture(m_source.current());
+            advance();
+            ++m_lex_sub;
+            return true;
+        }
+        m_error = (int)json_error::illegal_literal;
+        return false;
+    }
     bool lex_boolean() {
         switch(m_lex_state-9) {
             case 0:
                 if(m_source.current()=='f') {
                     m_source.capture(m_source.current());
-                    m_source.advance();
+                    advance();
                     m_int = 0;
                     m_lex_state = 1+9;
                     return true;
                 }
                 if(m_source.current()=='t') {
                     m_source.capture(m_source.current());
-                    m_source.advance();
+                    advance();
                     m_int = 1;
                     m_lex_state = 6+9;
                     return true;
@@ -387,7 +1091,7 @@ private:
             case 1:
                 if(m_source.current()=='a') {
                     m_source.capture(m_source.current());
-                    m_source.advance();
+                    advance();
                     m_lex_state = 2+9;
                     return true;
                 }
@@ -396,7 +1100,7 @@ private:
             case 2:
                 if(m_source.current()=='l') {
                     m_source.capture(m_source.current());
-                    m_source.advance();
+                    advance();
                     m_lex_state = 3+9;
                     return true;
                 }
@@ -405,7 +1109,7 @@ private:
             case 3:
                 if(m_source.current()=='s') {
                     m_source.capture(m_source.current());
-                    m_source.advance();
+                    advance();
                     m_lex_state = 4+9;
                     return true;
                 }
@@ -414,7 +1118,7 @@ private:
             case 4:
                 if(m_source.current()=='e') {
                     m_source.capture(m_source.current());
-                    m_source.advance();
+                    advance();
                     m_lex_state = 5+9;
                     return true;
                 }
@@ -426,7 +1130,7 @@ private:
             case 6:
                 if(m_source.current()=='r') {
                     m_source.capture(m_source.current());
-                    m_source.advance();
+                    advance();
                     m_lex_state = 7+9;
                     return true;
                 }
@@ -435,7 +1139,7 @@ private:
             case 7:
                 if(m_source.current()=='u') {
                     m_source.capture(m_source.current());
-                    m_source.advance();
+                    advance();
                     m_lex_state = 4+9;
                     return true;
                 }
@@ -451,7 +1155,7 @@ private:
             case 0:
                 if(m_source.current()=='n') {
                     m_source.capture(m_source.current());
-                    m_source.advance();
+                    advance();
                     m_lex_state = 1+16;
                     return true;
                 }
@@ -460,7 +1164,7 @@ private:
             case 1:
                 if(m_source.current()=='u') {
                     m_source.capture(m_source.current());
-                    m_source.advance();
+                    advance();
                     m_lex_state = 2+16;
                     return true;
                 }
@@ -469,7 +1173,7 @@ private:
             case 2:
                 if(m_source.current()=='l') {
                     m_source.capture(m_source.current());
-                    m_source.advance();
+                    advance();
                     m_lex_state = 3+16;
                     return true;
                 }
@@ -478,7 +1182,7 @@ private:
             case 3:
                 if(m_source.current()=='l') {
                     m_source.capture(m_source.current());
-                    m_source.advance();
+                    advance();
                     m_lex_state = 4+16;
                     return true;
                 }
@@ -492,39 +1196,76 @@ private:
                 return false;
         }
     }
+    void capture_utf8(int32_t cp) {
+        if(cp<0x80) {
+            m_source.capture(cp);
+        } else if(cp<0x800) {
+            m_source.capture(0xC0 | (cp>>6));
+            m_source.capture(0x80 | (cp & 0x3F));
+        } else if(cp<0x10000) {
+            m_source.capture(0xE0 | (cp>>12));
+            m_source.capture(0x80 | ((cp>>6) & 0x3F));
+            m_source.capture(0x80 | (cp & 0x3F));
+        } else {
+            m_source.capture(0xF0 | (cp>>18));
+            m_source.capture(0x80 | ((cp>>12) & 0x3F));
+            m_source.capture(0x80 | ((cp>>6) & 0x3F));
+            m_source.capture(0x80 | (cp & 0x3F));
+        }
+    }
+    static bool is_high_surrogate(int32_t cp) {
+        return cp>=0xD800 && cp<=0xDBFF;
+    }
+    static bool is_low_surrogate(int32_t cp) {
+        return cp>=0xDC00 && cp<=0xDFFF;
+    }
+    // string states (offset by 21):
+    // 0 open quote, 1 body, 2 done, 3 escape, 4-7 \u hex,
+    // 8 expect '\' of a low surrogate, 9 expect 'u' of a low surrogate,
+    // 10-13 low surrogate hex, 14 emit m_lex_accum
+    // m_lex_sub holds a pending high surrogate
     bool lex_string() {
         switch(m_lex_state-21) {
             case 0:
                 if(m_source.current()=='\"') {
-                    if(m_raw_strings) {
+                    if(is_raw()) {
                         m_source.capture(m_source.current());
                     }
-                    m_source.advance();
+                    advance();
                     m_lex_state = 1+21;
                     return true;
                 }
                 m_error = (int)json_error::illegal_literal;
                 return false;
             case 1:
-                if(!m_source.eof() && (m_source.current()!='\"' && m_source.current()!='\n' && m_source.current()!='\\')) {
-                    m_source.capture(m_source.current());
-                    m_source.advance();
-                    // m_lex_state = 1+21;
+                // copy the whole run up to the next quote or escape
+                // here rather than going around the state machine
+                // for every character
+                while(m_source.capture_size()<m_source.capture_capacity()-3) {
+                    int32_t ch = m_source.current();
+                    // the strict grammar doesn't allow any control characters
+                    if(ch=='\"' || ch=='\\' || (Dialect::grammar==json_grammar::strict?ch<0x20:ch=='\n') || m_source.eof()) {
+                        break;
+                    }
+                    m_source.capture(ch);
+                    advance();
+                }
+                if(m_source.capture_size()>=m_source.capture_capacity()-3) {
                     return true;
                 }
                 if(m_source.current()=='\"') {
-                    if(m_raw_strings) {
+                    if(is_raw()) {
                         m_source.capture(m_source.current());
                     }
-                    m_source.advance();
+                    advance();
                     m_lex_state = 2+21;
                     return true;
                 }
                 if(m_source.current()=='\\') {
-                    if(m_raw_strings) {
+                    if(is_raw()) {
                         m_source.capture(m_source.current());
                     }
-                    m_source.advance();
+                    advance();
                     m_lex_state = 3+21;
                     return true;
                 }
@@ -540,54 +1281,54 @@ private:
                     case '/':
                     case '\\':
                         m_source.capture(m_source.current());
-                        m_source.advance();
+                        advance();
                         break;
                     case 'b':
-                        if(m_raw_strings) {
+                        if(is_raw()) {
                             m_source.capture(m_source.current());
                         } else {
                             m_source.capture('\b');
                         }
-                        m_source.advance();
+                        advance();
                         break;
                     case 'f':
-                        if(m_raw_strings) {
+                        if(is_raw()) {
                             m_source.capture(m_source.current());
                         } else {
                             m_source.capture('\f');
                         }
-                        m_source.advance();
+                        advance();
                         break;
                     case 'n':
-                        if(m_raw_strings) {
+                        if(is_raw()) {
                             m_source.capture(m_source.current());
                         } else {
                             m_source.capture('\n');
                         }
-                        m_source.advance();
+                        advance();
                         break;
                     case 'r':
-                        if(m_raw_strings) {
+                        if(is_raw()) {
                             m_source.capture(m_source.current());
                         } else {
                             m_source.capture('\r');
                         }
-                        m_source.advance();
+                        advance();
                         break;
                     case 't':
-                        if(m_raw_strings) {
+                        if(is_raw()) {
                             m_source.capture(m_source.current());
                         } else {
                             m_source.capture('\t');
                         }
-                        m_source.advance();
+                        advance();
                         break;
                     case 'u':
-                        if(m_raw_strings) {
+                        if(is_raw()) {
                             m_source.capture(m_source.current());
                         }
                         m_lex_accum = 0;
-                        m_source.advance();
+                        advance();
                         m_lex_state = 4+21;
                         return true;
                     default:
@@ -601,13 +1342,16 @@ private:
             case 4:
             case 5:
             case 6:
+            case 10:
+            case 11:
+            case 12:
                 if(is_hex_char(m_source.current())) {
-                    if(m_raw_strings) {
+                    if(is_raw()) {
                         m_source.capture(m_source.current());
                     } 
                     m_lex_accum*=0x10;
                     m_lex_accum |= from_hex_char(m_source.current());
-                    m_source.advance();
+                    advance();
                     ++m_lex_state;
                     return true;
                 }
@@ -615,28 +1359,102 @@ private:
                 return false;
             case 7:
                 if(is_hex_char(m_source.current())) {
-                    if(m_raw_strings) {
-                            m_source.capture(m_source.current());
+                    if(is_raw()) {
+                        m_source.capture(m_source.current());
+                        advance();
+                        m_lex_state = 1+21;
+                        return true;
                     } 
                     m_lex_accum*=0x10;
                     m_lex_accum |= from_hex_char(m_source.current());
-                    if(!m_raw_strings) {
-                        m_source.capture(m_lex_accum);
+                    advance();
+                    if(is_high_surrogate(m_lex_accum)) {
+                        // wait for the low half
+                        m_lex_sub = m_lex_accum;
+                        m_lex_state = 8+21;
+                        return true;
+                    }
+                    capture_utf8(is_low_surrogate(m_lex_accum)?0xFFFD:m_lex_accum);
+                    m_lex_state = 1+21;
+                    return true;
+                }
+                m_error = (int)json_error::illegal_literal;
+                return false;
+            case 8:
+                if(m_source.current()=='\\') {
+                    advance();
+                    m_lex_state = 9+21;
+                    return true;
+                }
+                // unpaired high surrogate
+                capture_utf8(0xFFFD);
+                m_lex_state = 1+21;
+                return true;
+            case 9:
+                if(m_source.current()=='u') {
+                    advance();
+                    m_lex_accum = 0;
+                    m_lex_state = 10+21;
+                    return true;
+                }
+                // unpaired high surrogate followed by another escape
+                capture_utf8(0xFFFD);
+                m_lex_state = 3+21;
+                return true;
+            case 13:
+                if(is_hex_char(m_source.current())) {
+                    m_lex_accum*=0x10;
+                    m_lex_accum |= from_hex_char(m_source.current());
+                    advance();
+                    if(is_low_surrogate(m_lex_accum)) {
+                        capture_utf8(0x10000+((m_lex_sub-0xD800)<<10)+(m_lex_accum-0xDC00));
+                        m_lex_state = 1+21;
+                        return true;
+                    }
+                    // unpaired high surrogate followed by another \u
+                    capture_utf8(0xFFFD);
+                    if(is_high_surrogate(m_lex_accum)) {
+                        m_lex_sub = m_lex_accum;
+                        m_lex_state = 8+21;
+                    } else {
+                        m_lex_state = 14+21;
                     }
-                    m_source.advance();
-                    m_lex_state=1;
                     return true;
                 }
                 m_error = (int)json_error::illegal_literal;
                 return false;
+            case 14:
+                capture_utf8(m_lex_accum);
+                m_lex_state = 1+21;
+                return true;
             default:
                 m_error = (int)json_error::illegal_literal;
                 return false;
         }
     }
+    long long number_int() const {
+        if(Dialect::typed_numbers) {
+            if(m_value_type==json_value_type::real) {
+                // NaN and out of range values give 0
+                return (m_real>-9.2e18 && m_real<9.2e18)?(long long)m_real:0;
+            }
+            return m_int;
+        }
+        // convert on demand
+        if(m_value_type==json_value_type::integer) {
+            return strtoll(m_source.const_capture_buffer(),nullptr,10);
+        }
+        return (long long)strtod(m_source.const_capture_buffer(),nullptr);
+    }
+    double number_real() const {
+        if(Dialect::typed_numbers) {
+            return m_value_type==json_value_type::real?m_real:(double)m_int;
+        }
+        return strtod(m_source.const_capture_buffer(),nullptr);
+    }
     bool skip_if_comma() {
         if(m_source.more() && ','==m_source.current()) {
-            m_source.advance();
+            advance();
             skip_whitespace();
             if(m_source.eof()) {
                 m_error = (int)json_error::unterminated_element;
@@ -648,9 +1466,10 @@ private:
 
     bool read_any_open() {
         skip_whitespace();
+        m_node_position = m_position;
         switch(m_source.current()) {
             case '[':
-                if(!m_source.advance()) {
+                if(!advance()) {
                     m_error = (int)json_error::unterminated_array;
                     return false;
                 }
@@ -659,10 +1478,13 @@ private:
                     m_error =  (int)json_error::unterminated_array;
                     return false;
                 }
+                if(!open_nesting(false)) {
+                    return false;
+                }
                 m_state = (int)json_node_type::array;
                 return true;
             case '{':
-                if(!m_source.advance()) {
+                if(!advance()) {
                     m_error = (int)json_error::unterminated_object;
                     return false;
                 }
@@ -671,6 +1493,9 @@ private:
                     m_error =  (int)json_error::unterminated_object;
                     return false;
                 }
+                if(!open_nesting(true)) {
+                    return false;
+                }
                 m_state = (int)json_node_type::object;
                 ++m_depth;
                 return true;
@@ -684,9 +1509,20 @@ private:
             case '6':
             case '7':
             case '8':
-            case '9': {
+            case '9':
+            case 'N':
+            case 'I': {
                 m_source.clear_capture();
                 m_lex_state = 0;
+                if(m_source.current()=='N' || m_source.current()=='I') {
+                    if(Dialect::grammar!=json_grammar::lenient) {
+                        break;
+                    }
+                    m_lex_neg = false;
+                    m_lex_accum = m_source.current()=='I';
+                    m_lex_sub = 0;
+                    m_lex_state = 40;
+                }
                 bool more = false;
                 while(m_source.capture_size()<m_source.capture_capacity()-3 && (more=lex_number()));
                 if(more) {
@@ -741,20 +1577,23 @@ private:
                 m_lex_state = 21;
                 bool more = false;
                 while(m_source.capture_size()<m_source.capture_capacity()-3 && (more=lex_string()));
-                skip_whitespace();
-                bool field = m_source.current()==':';
                 if(more) {
-                    if(field) {
-                        m_error = (int)json_error::field_too_long;
-                        return false;
-                    }
+                    // can't look past the string yet without eating
+                    // whitespace inside it
                     m_state = (int)json_node_type::value_part;
                     return true;
                 }
                 else {
+                    skip_whitespace();
+                    bool field = m_source.current()==':';
+                    if(field && Dialect::grammar==json_grammar::strict && !m_resumed) {
+                        // fields are read by read_field(), only in objects
+                        m_error = (int)json_error::illegal_character;
+                        return false;
+                    }
                     if(m_error==0) {
                         if(field) {
-                            m_source.advance();
+                            advance();
                             m_state = (int)json_node_type::field;
                         } else {
                             m_state = (int)json_node_type::value;
@@ -765,17 +1604,30 @@ private:
                 return false;
             }
         }
+        if(m_error==0) {
+            m_error = (int)(m_source.eof()?json_error::unterminated_element:json_error::illegal_character);
+        }
         return false;
     }
     bool read_field_or_end_object() {
         skip_whitespace();
+        m_node_position = m_position;
+        if(m_source.current()=='}') {
+            if(!close_nesting(true)) {
+                return false;
+            }
+            --m_depth;
+            advance();
+            skip_whitespace();
+            m_state = (int)json_node_type::end_object;
+            return true;
+        }
+        return read_field();
+    }
+    bool read_field() {
+        skip_whitespace();
+        m_node_position = m_position;
         switch(m_source.current()) {
-            case '}':
-                --m_depth;
-                m_source.advance();
-                skip_whitespace();
-                m_state = (int)json_node_type::end_object;
-                return true;
             case '\"':
                 m_source.clear_capture();
                 m_lex_state = 21;
@@ -794,45 +1646,91 @@ private:
                         m_error=(int)json_error::field_missing_value;
                         return false;
                     }
-                    m_source.advance();
+                    advance();
                     m_state = (int)json_node_type::field;
                     return true;
                 
                 }
                 return false;
         }
+        // field names are strings
+        m_error = (int)json_error::illegal_character;
         return false;
     }
-    bool read_any() {
-        if(!m_source.more()) {
+    // ends the document, unless it was cut off with containers still open
+    bool end_input() {
+        if(m_nesting!=0 && !m_resumed) {
+            if(m_state==(int)json_node_type::object || m_state==(int)json_node_type::field) {
+                m_error = (int)json_error::unterminated_object;
+            } else if(m_state==(int)json_node_type::array || m_depth==0) {
+                // m_depth only counts objects
+                m_error = (int)json_error::unterminated_array;
+            } else if(m_depth==m_nesting) {
+                m_error = (int)json_error::unterminated_object;
+            } else {
+                m_error = (int)json_error::unterminated_element;
+            }
             return false;
         }
+        m_state = (int)json_node_type::end_document;
+        return false;
+    }
+    bool read_any() {
         skip_whitespace();
+        if(!m_source.more()) {
+            // trailing whitespace
+            return end_input();
+        }
+        m_node_position = m_position;
         switch(m_source.current()) {
             case ']':
-                m_source.advance();
+                if(!close_nesting(false)) {
+                    return false;
+                }
+                advance();
                 m_state = (int)json_node_type::end_array;
                 return true;
+            case ':':
+                // a field name that spilled into value parts
+                m_error = (int)json_error::field_too_long;
+                return false;
             case '}':
-                m_source.advance();
-                if(m_depth==0) {
+                if(m_depth==0 || !close_nesting(true)) {
                     m_error = (int)json_error::illegal_character;
                     return false;
                 }
+                advance();
                 --m_depth;
                 m_state = (int)json_node_type::end_object;
                 return true;
         }
+        if((m_nesting==0 && !m_resumed) || m_source.current()!=',') {
+            // only one root value, and values are separated by commas
+            m_error = (int)json_error::illegal_character;
+            return false;
+        }
         if(!skip_if_comma()) {
             return false;
         }
+        if(Dialect::grammar==json_grammar::lenient && (m_source.current()==']' || m_source.current()=='}')) {
+            // trailing comma
+            return read_any();
+        }
+        if(kind_known() && in_object()) {
+            // a comma in an object is followed by another field
+            return read_field();
+        }
         return read_any_open();
     }
     bool read_value_or_end_array() {
             skip_whitespace();
+            m_node_position = m_position;
             switch(m_source.current()) {
                 case ']':
-                    m_source.advance();
+                    if(!close_nesting(false)) {
+                        return false;
+                    }
+                    advance();
                     skip_whitespace();
                     m_state = (int)json_node_type::end_array;
                     return true;
@@ -843,11 +1741,13 @@ private:
             }
         }
 public:    
-    json_reader_ex(stream& input) : m_source(&input),m_state((int)json_node_type::initial),m_depth(0), m_error(0),m_raw_strings(false) {
-
+    json_reader_ex(stream& input) : m_source(&input) {
+        reset_fields();
     }
-    json_reader_ex() : m_source(nullptr),m_state((int)json_node_type::error),m_depth(0),m_error(-1),m_raw_strings(false) {
-
+    json_reader_ex() : m_source(nullptr) {
+        reset_fields();
+        m_state = (int)json_node_type::error;
+        m_error = -1;
     }
     json_reader_ex(json_reader_ex&& rhs) {
         do_move(rhs);
@@ -884,7 +1784,7 @@ public:
     virtual long long value_int() const override {
         json_value_type vt = value_type();
         if(vt==json_value_type::integer || vt==json_value_type::real) {
-            return m_int;
+            return number_int();
         }
         if(vt==json_value_type::boolean) {
             return m_int!=0;
@@ -896,7 +1796,7 @@ public:
     virtual double value_real() const override {
         json_value_type vt = value_type();
         if(vt==json_value_type::integer || vt==json_value_type::real) {
-            return m_real;
+            return number_real();
         }
         if(vt==json_value_type::boolean) {
             return m_int!=0;
@@ -907,9 +1807,12 @@ public:
     /// @return The bool value
     virtual bool value_bool() const override {
         json_value_type vt = value_type();
-        if(vt==json_value_type::boolean || vt==json_value_type::integer || vt==json_value_type::real) {
+        if(vt==json_value_type::boolean) {
             return m_int!=0;
         }
+        if(vt==json_value_type::integer || vt==json_value_type::real) {
+            return number_int()!=0;
+        }
         return false;
     }
     /// @brief Returns the current string value under the cursor
@@ -924,12 +1827,22 @@ public:
             m_state == (int)json_node_type::value_part ||
             m_state == (int)json_node_type::end_value_part;
     }
+    /// @brief Indicates whether or not the value under the cursor is a string. Unlike value_type(), this is already known at the first value_part.
+    /// @return True if it's a string, otherwise false
+    virtual bool is_string() const override {
+        if(m_error==0 && m_state==(int)json_node_type::value_part) {
+            // 21 to 39 are the string states
+            return m_lex_state>=21 && m_lex_state<40;
+        }
+        return json_reader_base::is_string();
+    }
     /// @brief Indicates whether or not strings are escaped and dequoted
     /// @return True if not escaped and dequoted, otherwise false
     virtual bool raw_strings() const override {
-        return m_raw_strings;
+        return is_raw();
     }
     /// @brief Sets whether or not the strings are escaped and dequoted
+    /// @details Has no effect unless the dialect chooses strings at runtime
     /// @param value True if the strings are not escaped and dequoted, otherwise false
     virtual void raw_strings(bool value) override {
         m_raw_strings = value;
@@ -942,13 +1855,245 @@ public:
     /// @brief Sets the stream and resets the reader
     /// @param stream The new stream
     virtual void set(io::stream& stream) {
+        if(stream.caps().read==0) {
+            return;
+        }
+        bool raw = m_raw_strings;
+        reset(stream);
+        m_raw_strings = raw;
+    }
+    /// @brief Sets the stream and restores the reader to its freshly constructed state, including raw_strings()
+    /// @param stream The new stream
+    virtual void reset(io::stream& stream) {
         if(stream.caps().read==0) {
             return;
         }
         m_source = &stream;
-        m_state = (int)json_node_type::initial;
-        m_depth = 0;
-        m_error = 0;
+        reset_fields();
+    }
+    /// @brief Sets the stream and resumes reading in the middle of a document
+    /// @details The stream must already be positioned at the start of a value or field, such as one recorded with node_position()
+    /// @param stream The new stream
+    /// @param depth The depth() before the node at the resume point
+    /// @param position The byte offset of the resume point within the document
+    virtual void set(io::stream& stream, unsigned int depth, unsigned long long position) {
+        if(stream.caps().read==0) {
+            return;
+        }
+        set(stream);
+        m_depth = depth;
+        // the arrays around the resume point aren't known
+        m_nesting = depth;
+        m_resumed = true;
+        m_position = position;
+        m_node_position = position;
+    }
+    /// @brief Indicates the byte offset of the next character to be read
+    /// @return The offset from the start of the document
+    unsigned long long position() const {
+        return m_position;
+    }
+    /// @brief Indicates the byte offset where the node under the cursor starts
+    /// @details For value parts this is the start of the entire value
+    /// @return The offset from the start of the document
+    unsigned long long node_position() const {
+        return m_node_position;
+    }
+    /// @brief Indicates the byte offset where the error was found
+    /// @details This is the running position, so tracking it costs nothing extra while reading
+    /// @return The offset from the start of the document. Only meaningful when error() is not json_error::none.
+    unsigned long long error_offset() const {
+        return m_position;
+    }
+    /// @brief Computes the line and column of the error by rescanning the document from a stream
+    /// @details Costs nothing until it's called. The stream's position is restored afterward.
+    /// @param input A seekable stream over the document, which starts at offset 0
+    /// @param line Receives the 1 based line
+    /// @param column Receives the 1 based column, in bytes
+    /// @return True if successful, otherwise false
+    bool error_location(stream& input, unsigned long* line, unsigned long* column) const {
+        if(input.caps().seek==0) {
+            return false;
+        }
+        unsigned long long restore = input.seek(0,io::seek_origin::current);
+        input.seek(0);
+        unsigned long long remaining = m_position;
+        unsigned long ln = 1;
+        unsigned long long line_start = 0;
+        unsigned long long offset = 0;
+        uint8_t buf[64];
+        while(remaining>0) {
+            size_t count = input.read(buf,remaining<sizeof(buf)?(size_t)remaining:sizeof(buf));
+            if(count==0) {
+                break;
+            }
+            for(size_t i = 0;i<count;++i) {
+                if(buf[i]=='\n') {
+                    ++ln;
+                    line_start = offset+i+1;
+                }
+            }
+            offset+=count;
+            remaining-=count;
+        }
+        input.seek(restore);
+        if(remaining>0) {
+            return false;
+        }
+        *line = ln;
+        *column = (unsigned long)(m_position-line_start)+1;
+        return true;
+    }
+    /// @brief Computes the line and column of the error by rescanning the document in memory
+    /// @param data The document
+    /// @param size The size of the document in bytes
+    /// @param line Receives the 1 based line
+    /// @param column Receives the 1 based column, in bytes
+    /// @return True if successful, otherwise false
+    bool error_location(const char* data, size_t size, unsigned long* line, unsigned long* column) const {
+        if(m_position>size) {
+            return false;
+        }
+        unsigned long ln = 1;
+        const char* line_start = data;
+        const char* end = data+m_position;
+        const char* nl;
+        while(line_start<end && (nl = (const char*)memchr(line_start,'\n',end-line_start))!=nullptr) {
+            ++ln;
+            line_start = nl+1;
+        }
+        *line = ln;
+        *column = (unsigned long)(end-line_start)+1;
+        return true;
+    }
+    /// @brief Skips the value under the cursor, or the value of the field under the cursor, including any children
+    /// @details Arrays and objects are skipped by scanning for the matching bracket without lexing what's inside, so the skipped content is not validated
+    /// @return True if successful, otherwise false
+    virtual bool skip_value() override {
+        if(m_error!=0) {
+            return false;
+        }
+        if(m_state==(int)json_node_type::field) {
+            if(!read()) {
+                return false;
+            }
+        }
+        if(m_state!=(int)json_node_type::array && m_state!=(int)json_node_type::object) {
+            return json_reader_base::skip_value();
+        }
+        // the cursor is just past the opening bracket
+        bool object = m_state==(int)json_node_type::object;
+        unsigned int nesting = 1;
+        while(m_source.more()) {
+            switch(m_source.current()) {
+                case '\"':
+                    // skip the string, minding escapes
+                    while(true) {
+                        if(!advance()) {
+                            m_error = (int)json_error::unterminated_string;
+                            return false;
+                        }
+                        if(m_source.current()=='\\') {
+                            if(!advance()) {
+                                m_error = (int)json_error::unterminated_string;
+                                return false;
+                            }
+                        } else if(m_source.current()=='\"') {
+                            break;
+                        }
+                    }
+                    break;
+                case '[':
+                case '{':
+                    ++nesting;
+                    break;
+                case ']':
+                case '}':
+                    if(--nesting==0) {
+                        if((m_source.current()=='}')!=object || !close_nesting(object)) {
+                            m_error = (int)json_error::illegal_character;
+                            return false;
+                        }
+                        m_node_position = m_position;
+                        advance();
+                        if(object) {
+                            --m_depth;
+                            m_state = (int)json_node_type::end_object;
+                        } else {
+                            m_state = (int)json_node_type::end_array;
+                        }
+                        return true;
+                    }
+                    break;
+                case '/':
+                    if(Dialect::grammar==json_grammar::lenient) {
+                        skip_comment();
+                        if(m_error!=0) {
+                            return false;
+                        }
+                        continue;
+                    }
+                    break;
+            }
+            advance();
+        }
+        m_error = (int)(object?json_error::unterminated_object:json_error::unterminated_array);
+        return false;
+    }
+    /// @brief Reads up to count nodes into an array of records, saving the per node calls of read()
+    /// @details Strings are copied into the arena, where they remain valid until the arena is reused. Reading stops early once the arena has less than CaptureSize bytes free, so it should be many times that size. An arena smaller than CaptureSize, or no records, fails with json_error::buffer_too_small, since not even one node would fit.
+    /// @param records The records to fill
+    /// @param count The number of records
+    /// @param arena The buffer to copy strings into
+    /// @param arena_size The size of the arena in bytes
+    /// @return The number of records filled. A full arena can make this less than count, but it is only 0 at the end of the document or on error.
+    size_t read_batch(json_node_record* records, size_t count, char* arena, size_t arena_size) {
+        if(m_error==0 && (count==0 || arena_size<CaptureSize)) {
+            m_error = (int)json_error::buffer_too_small;
+            return 0;
+        }
+        size_t result = 0;
+        while(result<count && arena_size>=CaptureSize && json_reader_ex::read()) {
+            json_node_record& rec = records[result++];
+            rec.node_type = (json_node_type)m_state;
+            rec.depth = m_depth;
+            rec.integer = 0;
+            switch(rec.node_type) {
+                case json_node_type::value:
+                case json_node_type::end_value_part:
+                    rec.value_type = m_value_type;
+                    if(m_value_type==json_value_type::real) {
+                        rec.real = number_real();
+                    } else if(m_value_type==json_value_type::integer) {
+                        rec.integer = number_int();
+                    } else if(m_value_type==json_value_type::boolean) {
+                        rec.integer = m_int!=0;
+                    }
+                    break;
+                default:
+                    rec.value_type = json_value_type::none;
+                    break;
+            }
+            switch(rec.node_type) {
+                case json_node_type::field:
+                case json_node_type::value:
+                case json_node_type::value_part:
+                case json_node_type::end_value_part: {
+                    size_t size = m_source.capture_size();
+                    memcpy(arena,m_source.const_capture_buffer(),size+1);
+                    rec.value = arena;
+                    rec.length = (unsigned int)size;
+                    arena += size+1;
+                    arena_size -= size+1;
+                    break;
+                }
+                default:
+                    rec.value = nullptr;
+                    rec.length = 0;
+                    break;
+            }
+        }
+        return result;
     }
     /// @brief Reads the next element
     /// @return True if successful, otherwise error or no more data
@@ -956,24 +2101,27 @@ public:
         if(m_error!=0) {
             return false;
         }
-        if(!m_source.ensure_started() || !m_source.more()) {
+        if(!m_source.ensure_started()) {
             m_state = (int)json_node_type::end_document;
             return false;
         }
+        // a value in parts still has to finish, even at the end of input
+        if(!m_source.more() && m_state!=(int)json_node_type::value_part) {
+            return end_input();
+        }
         switch((json_node_type)m_state) {
             case json_node_type::error:
             case json_node_type::end_document:
                 return false;
             case json_node_type::initial:
-                m_depth = 0;
                 skip_whitespace();
                 if(!read_any_open()) {
                     return false;
                 }
                 break;
             case json_node_type::value_part:
-                // 0, 9, 16, 21
-                if(m_lex_state>=21) {
+                // 0, 9, 16, 21, 40
+                if(m_lex_state>=21 && m_lex_state<40) {
                     m_source.clear_capture();
                     bool more = false;
                     while(m_source.capture_size()<m_source.capture_capacity()-3 && (more=lex_string()));
@@ -1060,9 +2208,18 @@ public:
                 }
                 break;
         }   
+        if(Dialect::grammar==json_grammar::lenient) {
+            // comments can fail after the node is read
+            return m_error==0;
+        }
         return true;    
     }
 };
+// state budgets, beyond the lex source and its capture buffer. the strict
+// grammar adds a bit per level: 8 bytes compact, 32 bytes otherwise
+static_assert(sizeof(json_reader_ex<64,json_compact_dialect>)<=sizeof(io::lex_source<64>)+48,"compact reader state is over budget");
+static_assert(sizeof(json_reader_ex<64>)<=sizeof(io::lex_source<64>)+96,"reader state is over budget");
+static_assert(sizeof(json_reader_ex<64,json_dialect<json_strings::runtime,json_grammar::lenient>>)<=sizeof(io::lex_source<64>)+64,"lenient reader state is over budget");
 using json_reader = json_reader_ex<1024>;
 }
 #endif // HTCW_JSON_HPP
@@ -0,0 +1,487 @@
+#ifndef HTCW_JSON_AGGREGATE_HPP
+#define HTCW_JSON_AGGREGATE_HPP
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "json.hpp"
+#include "json_path.hpp"
+namespace json {
+// Aggregates consume nodes through update(reader), called after each read(),
+// and report through live() whether the array or object that just started
+// may hold anything they need. json_aggregate() drives any number of them
+// over one pass and skips containers none of them need.
+
+/// @brief Counts the values at a path, of any type
+/// @tparam MaxDepth The maximum nesting tracked
+template <size_t MaxDepth = 32>
+class json_count_ex final {
+    json_path_ex<MaxDepth> m_path;
+    unsigned long long m_count;
+public:
+    /// @brief Constructs the aggregate
+    /// @param path The path of the values, such as "seasons[].episodes[]"
+    json_count_ex(const char* path) : m_path(path), m_count(0) {
+    }
+    /// @brief Consumes the node under the cursor
+    /// @param reader The reader
+    void update(const json_reader_base& reader) {
+        if(m_path.update(reader)) {
+            ++m_count;
+        }
+    }
+    /// @brief Indicates whether the array or object under the cursor may contain values of interest
+    /// @return True if it may, otherwise false
+    bool live() const {
+        return m_path.prefix_matched();
+    }
+    /// @brief Clears the results
+    void reset() {
+        m_path.reset();
+        m_count = 0;
+    }
+    /// @brief Indicates the number of values
+    /// @return The count
+    unsigned long long count() const {
+        return m_count;
+    }
+};
+/// @brief Computes the count, sum, minimum, maximum and mean of the numbers at a path. Other values are ignored.
+/// @tparam MaxDepth The maximum nesting tracked
+template <size_t MaxDepth = 32>
+class json_stats_ex final {
+    json_path_ex<MaxDepth> m_path;
+    unsigned long long m_count;
+    double m_sum;
+    double m_min;
+    double m_max;
+public:
+    /// @brief Constructs the aggregate
+    /// @param path The path of the values, such as "seasons[].episodes[].vote_average"
+    json_stats_ex(const char* path) : m_path(path) {
+        reset();
+    }
+    /// @brief Consumes the node under the cursor
+    /// @param reader The reader
+    void update(const json_reader_base& reader) {
+        if(m_path.update(reader) && reader.node_type() == json_node_type::value) {
+            json_value_type vt = reader.value_type();
+            if(vt == json_value_type::integer || vt == json_value_type::real) {
+                double v = reader.value_real();
+                if(m_count == 0 || v < m_min) {
+                    m_min = v;
+                }
+                if(m_count == 0 || v > m_max) {
+                    m_max = v;
+                }
+                m_sum += v;
+                ++m_count;
+            }
+        }
+    }
+    /// @brief Indicates whether the array or object under the cursor may contain values of interest
+    /// @return True if it may, otherwise false
+    bool live() const {
+        return m_path.prefix_matched();
+    }
+    /// @brief Clears the results
+    void reset() {
+        m_path.reset();
+        m_count = 0;
+        m_sum = 0;
+        m_min = 0;
+        m_max = 0;
+    }
+    /// @brief Indicates the number of numbers
+    /// @return The count
+    unsigned long long count() const {
+        return m_count;
+    }
+    /// @brief Indicates the sum
+    /// @return The sum
+    double sum() const {
+        return m_sum;
+    }
+    /// @brief Indicates the smallest number
+    /// @return The minimum, or 0 if there were no numbers
+    double min() const {
+        return m_min;
+    }
+    /// @brief Indicates the largest number
+    /// @return The maximum, or 0 if there were no numbers
+    double max() const {
+        return m_max;
+    }
+    /// @brief Indicates the arithmetic mean
+    /// @return The mean, or 0 if there were no numbers
+    double mean() const {
+        return m_count == 0 ? 0 : m_sum / m_count;
+    }
+};
+/// @brief Counts the numbers at a path in equal width bins
+/// @details NaN and Infinity are skipped
+/// @tparam Bins The number of bins
+/// @tparam MaxDepth The maximum nesting tracked
+template <size_t Bins = 10, size_t MaxDepth = 32>
+class json_histogram_ex final {
+    static_assert(Bins > 0, "Bins must be at least 1");
+    json_path_ex<MaxDepth> m_path;
+    double m_low;
+    double m_high;
+    unsigned long long m_bins[Bins];
+    unsigned long long m_underflow;
+    unsigned long long m_overflow;
+public:
+    constexpr static const size_t bins = Bins;
+    /// @brief Constructs the aggregate
+    /// @param path The path of the values, such as "seasons[].episodes[].vote_average"
+    /// @param low The low end of the first bin
+    /// @param high The high end of the last bin, inclusive
+    json_histogram_ex(const char* path, double low, double high) : m_path(path), m_low(low), m_high(high) {
+        reset();
+    }
+    /// @brief Consumes the node under the cursor
+    /// @param reader The reader
+    void update(const json_reader_base& reader) {
+        if(m_path.update(reader) && reader.node_type() == json_node_type::value) {
+            json_value_type vt = reader.value_type();
+            if(vt == json_value_type::integer || vt == json_value_type::real) {
+                double v = reader.value_real();
+                // NaN and Infinity (lenient dialects) aren't counted anywhere
+                if(v - v != 0) {
+                    return;
+                }
+                if(v < m_low) {
+                    ++m_underflow;
+                } else if(v > m_high) {
+                    ++m_overflow;
+                } else {
+                    // compared as a double: the quotient is NaN or huge when the range overflows
+                    double f = m_high > m_low ? (v - m_low) / (m_high - m_low) * Bins : 0;
+                    size_t i = f > 0 ? (f < Bins ? (size_t)f : Bins - 1) : 0;
+                    ++m_bins[i];
+                }
+            }
+        }
+    }
+    /// @brief Indicates whether the array or object under the cursor may contain values of interest
+    /// @return True if it may, otherwise false
+    bool live() const {
+        return m_path.prefix_matched();
+    }
+    /// @brief Clears the results
+    void reset() {
+        m_path.reset();
+        memset(m_bins, 0, sizeof(m_bins));
+        m_underflow = 0;
+        m_overflow = 0;
+    }
+    /// @brief Indicates the count in a bin
+    /// @param index The bin
+    /// @return The count
+    unsigned long long bin(size_t index) const {
+        return index < Bins ? m_bins[index] : 0;
+    }
+    /// @brief Indicates the low end of a bin
+    /// @param index The bin
+    /// @return The low end
+    double bin_low(size_t index) const {
+        return m_low + (m_high - m_low) * index / Bins;
+    }
+    /// @brief Indicates the number of values below the first bin
+    /// @return The count
+    unsigned long long underflow() const {
+        return m_underflow;
+    }
+    /// @brief Indicates the number of values above the last bin
+    /// @return The count
+    unsigned long long overflow() const {
+        return m_overflow;
+    }
+};
+namespace {
+    constexpr size_t json_aggregate_pow2(size_t value, size_t result = 1) {
+        return result >= value ? result : json_aggregate_pow2(value, result * 2);
+    }
+}
+/// @brief Groups the objects at a path by a string key and aggregates a number in each group
+/// @details Keys longer than KeySize-1 are truncated. Once Capacity groups exist, rows with new keys are counted by dropped().
+/// @tparam Capacity The maximum number of groups
+/// @tparam KeySize The size of the buffer for each key
+/// @tparam MaxDepth The maximum nesting tracked
+template <size_t Capacity = 64, size_t KeySize = 32, size_t MaxDepth = 32>
+class json_group_by_ex final {
+    static_assert(Capacity > 0 && Capacity < 0xFFFF, "Capacity must be between 1 and 65534");
+    static_assert(KeySize > 1, "KeySize must be at least 2");
+public:
+    /// @brief The results for one key
+    struct group {
+        /// @brief The key
+        char key[KeySize];
+        /// @brief The number of rows with the key
+        unsigned long long count;
+        /// @brief The number of rows with the key and a numeric value
+        unsigned long long value_count;
+        /// @brief The sum of the values
+        double sum;
+        /// @brief The smallest value
+        double min;
+        /// @brief The largest value
+        double max;
+        /// @brief Indicates the arithmetic mean of the values
+        /// @return The mean, or 0 if there were no values
+        double mean() const {
+            return value_count == 0 ? 0 : sum / value_count;
+        }
+    };
+private:
+    constexpr static const size_t table_size = json_aggregate_pow2(Capacity * 2);
+    json_path_ex<MaxDepth> m_path;
+    const char* m_key_field;
+    const char* m_value_field;
+    group m_groups[Capacity];
+    // open addressed slots holding group index + 1, or 0 if empty
+    uint16_t m_slots[table_size];
+    size_t m_size;
+    unsigned long long m_dropped;
+    // the current row
+    int m_row_nesting;
+    // 0 = ignoring, 1 = reading the key, 2 = reading the value
+    int m_current;
+    char m_key[KeySize];
+    size_t m_key_len;
+    bool m_has_key;
+    bool m_has_value;
+    double m_value;
+    bool m_live;
+    static uint32_t hash(const char* sz) {
+        // FNV-1a
+        uint32_t result = 2166136261u;
+        while(*sz) {
+            result = (result ^ (uint8_t)*sz++) * 16777619u;
+        }
+        return result;
+    }
+    void append_key(const char* sz) {
+        size_t len = strlen(sz);
+        if(m_key_len + len > KeySize - 1) {
+            len = KeySize - 1 - m_key_len;
+        }
+        memcpy(m_key + m_key_len, sz, len);
+        m_key_len += len;
+        m_key[m_key_len] = 0;
+    }
+    void commit() {
+        if(!m_has_key) {
+            return;
+        }
+        size_t mask = table_size - 1;
+        size_t i = hash(m_key) & mask;
+        group* g = nullptr;
+        while(m_slots[i] != 0) {
+            group& candidate = m_groups[m_slots[i] - 1];
+            if(0 == strcmp(candidate.key, m_key)) {
+                g = &candidate;
+                break;
+            }
+            i = (i + 1) & mask;
+        }
+        if(g == nullptr) {
+            if(m_size == Capacity) {
+                ++m_dropped;
+                return;
+            }
+            g = m_groups + m_size;
+            memcpy(g->key, m_key, m_key_len + 1);
+            g->count = 0;
+            g->value_count = 0;
+            g->sum = 0;
+            g->min = 0;
+            g->max = 0;
+            m_slots[i] = (uint16_t)++m_size;
+        }
+        ++g->count;
+        if(m_has_value) {
+            if(g->value_count == 0 || m_value < g->min) {
+                g->min = m_value;
+            }
+            if(g->value_count == 0 || m_value > g->max) {
+                g->max = m_value;
+            }
+            g->sum += m_value;
+            ++g->value_count;
+        }
+    }
+public:
+    /// @brief Constructs the aggregate
+    /// @param rows_path The path of the objects to group, such as "seasons[].episodes[]"
+    /// @param key_field The field of each object holding the key. Non-string keys use their JSON text.
+    /// @param value_field The field of each object holding the number to aggregate, or null to only count
+    json_group_by_ex(const char* rows_path, const char* key_field, const char* value_field = nullptr) : m_path(rows_path), m_key_field(key_field), m_value_field(value_field) {
+        reset();
+    }
+    /// @brief Consumes the node under the cursor. Strings should be decoded.
+    /// @param reader The reader
+    void update(const json_reader_base& reader) {
+        bool row = m_path.update(reader);
+        json_node_type nt = reader.node_type();
+        m_live = false;
+        if(m_row_nesting == 0) {
+            if(row && nt == json_node_type::object) {
+                m_row_nesting = 1;
+                m_current = 0;
+                m_key_len = 0;
+                m_key[0] = 0;
+                m_has_key = false;
+                m_has_value = false;
+                m_live = true;
+            } else {
+                m_live = m_path.prefix_matched();
+            }
+            return;
+        }
+        switch(nt) {
+            case json_node_type::array:
+            case json_node_type::object:
+                // nothing below the row's own fields is needed
+                m_current = 0;
+                ++m_row_nesting;
+                break;
+            case json_node_type::end_array:
+            case json_node_type::end_object:
+                if(--m_row_nesting == 0) {
+                    commit();
+                }
+                break;
+            case json_node_type::field:
+                if(m_row_nesting == 1) {
+                    const char* name = reader.value();
+                    m_current = 0 == strcmp(name, m_key_field) ? 1 : (m_value_field != nullptr && 0 == strcmp(name, m_value_field)) ? 2 : 0;
+                }
+                break;
+            case json_node_type::value:
+            case json_node_type::value_part:
+            case json_node_type::end_value_part:
+                if(m_row_nesting == 1) {
+                    if(m_current == 1) {
+                        if(reader.value_type() != json_value_type::null) {
+                            if(!m_has_key) {
+                                m_key_len = 0;
+                            }
+                            append_key(reader.value());
+                            m_has_key = true;
+                        }
+                    } else if(m_current == 2 && nt == json_node_type::value) {
+                        json_value_type vt = reader.value_type();
+                        if(vt == json_value_type::integer || vt == json_value_type::real) {
+                            m_value = reader.value_real();
+                            m_has_value = true;
+                        }
+                    }
+                    if(nt != json_node_type::value_part) {
+                        m_current = 0;
+                    }
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    /// @brief Indicates whether the array or object under the cursor may contain values of interest
+    /// @return True if it may, otherwise false
+    bool live() const {
+        return m_live;
+    }
+    /// @brief Clears the results
+    void reset() {
+        m_path.reset();
+        memset(m_slots, 0, sizeof(m_slots));
+        m_size = 0;
+        m_dropped = 0;
+        m_row_nesting = 0;
+        m_current = 0;
+        m_key_len = 0;
+        m_key[0] = 0;
+        m_has_key = false;
+        m_has_value = false;
+        m_value = 0;
+        m_live = false;
+    }
+    /// @brief Indicates the number of groups
+    /// @return The number of groups
+    size_t size() const {
+        return m_size;
+    }
+    /// @brief Retrieves a group, in the order the keys were first seen
+    /// @param index The index of the group
+    /// @return The group
+    const group& at(size_t index) const {
+        return m_groups[index];
+    }
+    /// @brief Finds the group for a key
+    /// @param key The key
+    /// @return The group, or null if not found
+    const group* find(const char* key) const {
+        size_t mask = table_size - 1;
+        size_t i = hash(key) & mask;
+        while(m_slots[i] != 0) {
+            const group& candidate = m_groups[m_slots[i] - 1];
+            if(0 == strcmp(candidate.key, key)) {
+                return &candidate;
+            }
+            i = (i + 1) & mask;
+        }
+        return nullptr;
+    }
+    /// @brief Indicates the number of rows whose key didn't fit
+    /// @return The number of rows dropped
+    unsigned long long dropped() const {
+        return m_dropped;
+    }
+};
+namespace {
+    inline bool json_aggregate_live() {
+        return false;
+    }
+    template <typename Aggregate, typename... Rest>
+    bool json_aggregate_live(const Aggregate& aggregate, const Rest&... rest) {
+        return aggregate.live() || json_aggregate_live(rest...);
+    }
+    inline void json_aggregate_update(const json_reader_base&) {
+    }
+    template <typename Aggregate, typename... Rest>
+    void json_aggregate_update(const json_reader_base& reader, Aggregate& aggregate, Rest&... rest) {
+        aggregate.update(reader);
+        json_aggregate_update(reader, rest...);
+    }
+}
+/// @brief Reads the rest of a document, feeding every aggregate in a single pass
+/// @details Arrays and objects that no aggregate needs are skipped with skip_value(). Numbers are only converted when an aggregate selects them, so a dialect with TypedNumbers=false avoids converting the rest.
+/// @param reader The reader
+/// @param aggregates The aggregates, such as json_stats or json_group_by
+/// @return True if successful, otherwise false
+template <typename... Aggregates>
+bool json_aggregate(json_reader_base& reader, Aggregates&... aggregates) {
+    bool raw = reader.raw_strings();
+    reader.raw_strings(false);
+    bool result = true;
+    while(reader.read()) {
+        json_aggregate_update(reader, aggregates...);
+        json_node_type nt = reader.node_type();
+        if((nt == json_node_type::array || nt == json_node_type::object) && !json_aggregate_live(aggregates...)) {
+            if(!reader.skip_value()) {
+                result = false;
+                break;
+            }
+            // the end node balances the start the aggregates saw
+            json_aggregate_update(reader, aggregates...);
+        }
+    }
+    reader.raw_strings(raw);
+    return result && reader.error() == json_error::none;
+}
+using json_count = json_count_ex<>;
+using json_stats = json_stats_ex<>;
+using json_histogram = json_histogram_ex<>;
+using json_group_by = json_group_by_ex<>;
+}
+#endif // HTCW_JSON_AGGREGATE_HPP
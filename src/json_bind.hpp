@@ -0,0 +1,401 @@
+#ifndef HTCW_JSON_BIND_HPP
+#define HTCW_JSON_BIND_HPP
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "json.hpp"
+namespace json {
+/// @brief Describes a mapping from a JSON field to a struct member
+/// @tparam T The struct type
+/// @tparam M The member type
+template <typename T, typename M>
+struct json_field_desc {
+    using struct_type = T;
+    using member_type = M;
+    /// @brief The field name
+    const char* name;
+    /// @brief The member to bind to
+    M T::*member;
+};
+/// @brief Creates a field descriptor
+/// @tparam T The struct type
+/// @tparam M The member type
+/// @param name The field name
+/// @param member The member to bind to
+/// @return The descriptor
+template <typename T, typename M>
+constexpr json_field_desc<T, M> json_field(const char* name, M T::*member) {
+    return json_field_desc<T, M>{name, member};
+}
+/// @brief A compile time list of field descriptors
+template <typename... Fields>
+struct json_field_list;
+template <>
+struct json_field_list<> {
+    constexpr json_field_list() {
+    }
+};
+template <typename Field, typename... Rest>
+struct json_field_list<Field, Rest...> {
+    Field first;
+    json_field_list<Rest...> rest;
+    constexpr json_field_list(Field field, Rest... others) : first(field), rest(others...) {
+    }
+};
+/// @brief Creates a list of field descriptors
+/// @param fields The descriptors created with json_field()
+/// @return The list
+template <typename... Fields>
+constexpr json_field_list<Fields...> json_fields(Fields... fields) {
+    return json_field_list<Fields...>(fields...);
+}
+/// @brief Specialize this for each struct to bind, with a static constexpr fields() function returning json_fields(...)
+/// @tparam T The struct type
+template <typename T>
+struct json_binding;
+/// @brief A bindable value that may be absent or null
+/// @tparam T The value type
+template <typename T>
+struct json_optional {
+    /// @brief True if the value was present, not null and of a type that could be bound. Binding the enclosing struct clears it first.
+    bool has_value;
+    /// @brief The value
+    T value;
+};
+/// @brief A bindable array with a fixed capacity and a variable number of elements
+/// @tparam T The element type
+/// @tparam Capacity The maximum number of elements. Extra elements are skipped.
+template <typename T, size_t Capacity>
+struct json_array {
+    constexpr static const size_t capacity = Capacity;
+    /// @brief The number of elements. Binding the enclosing struct clears it first.
+    size_t size;
+    /// @brief The elements
+    T items[Capacity];
+    T& operator[](size_t index) {
+        return items[index];
+    }
+    const T& operator[](size_t index) const {
+        return items[index];
+    }
+};
+/// @brief Skips the value under the cursor, including any children
+/// @param reader The reader, positioned on a value, value_part, array or object node
+/// @return True if successful, otherwise false
+inline bool json_skip_current(json_reader_base& reader) {
+    return reader.node_type() != json_node_type::field && reader.skip_value();
+}
+/// @brief Binds the value under the cursor to a member of type M. Specialize this to support additional types.
+/// @details The reader is positioned on the first node of the value and is left on its last node. Values of the wrong shape are skipped and leave the member untouched. A specialization can also provide bind(reader, out, assigned), which reports whether the member was written, so a json_optional<M> knows whether it has a value. Without it, json_optional<M> has a value whenever the value isn't null.
+/// @tparam M The member type. Structs are bound through json_binding<M>.
+template <typename M>
+struct json_bind_value {
+    static bool bind(json_reader_base& reader, M& out) {
+        bool assigned;
+        return bind(reader, out, &assigned);
+    }
+    static bool bind(json_reader_base& reader, M& out, bool* assigned);
+};
+namespace {
+    template <typename T>
+    bool json_bind_field(const json_field_list<>&, const char*, json_reader_base&, T&, bool* found) {
+        *found = false;
+        return true;
+    }
+    // the comparisons unroll into a straight chain at compile time
+    template <typename T, typename Field, typename... Rest>
+    bool json_bind_field(const json_field_list<Field, Rest...>& fields, const char* name, json_reader_base& reader, T& out, bool* found) {
+        if(*name == *fields.first.name && 0 == strcmp(name, fields.first.name)) {
+            *found = true;
+            if(!reader.read()) {
+                return false;
+            }
+            return json_bind_value<typename Field::member_type>::bind(reader, out.*(fields.first.member));
+        }
+        return json_bind_field(fields.rest, name, reader, out, found);
+    }
+    // uses the binder's bind(reader, out, assigned) if it has one
+    template <typename T>
+    auto json_bind_assigned(json_reader_base& reader, T& out, bool* assigned, int) -> decltype(json_bind_value<T>::bind(reader, out, assigned)) {
+        return json_bind_value<T>::bind(reader, out, assigned);
+    }
+    template <typename T>
+    bool json_bind_assigned(json_reader_base& reader, T& out, bool* assigned, long) {
+        *assigned = true;
+        return json_bind_value<T>::bind(reader, out);
+    }
+    template <typename T>
+    void json_clear_members(const json_field_list<>&, T&);
+    template <typename T, typename Field, typename... Rest>
+    void json_clear_members(const json_field_list<Field, Rest...>& fields, T& out);
+    // nested structs are cleared along with their parent
+    template <typename M>
+    auto json_clear_member(M& member, int) -> decltype(json_binding<M>::fields(), void()) {
+        json_clear_members(json_binding<M>::fields(), member);
+    }
+    template <typename M>
+    void json_clear_member(M&, long) {
+    }
+    template <typename V>
+    void json_clear_member(json_optional<V>& member, int) {
+        member.has_value = false;
+    }
+    template <typename V, size_t Capacity>
+    void json_clear_member(json_array<V, Capacity>& member, int) {
+        member.size = 0;
+    }
+    template <typename T>
+    void json_clear_members(const json_field_list<>&, T&) {
+    }
+    // so members missing from this object don't keep values from a previous bind
+    template <typename T, typename Field, typename... Rest>
+    void json_clear_members(const json_field_list<Field, Rest...>& fields, T& out) {
+        json_clear_member(out.*(fields.first.member), 0);
+        json_clear_members(fields.rest, out);
+    }
+}
+template <typename M>
+bool json_bind_value<M>::bind(json_reader_base& reader, M& out, bool* assigned) {
+    *assigned = reader.node_type() == json_node_type::object;
+    if(!*assigned) {
+        return json_skip_current(reader);
+    }
+    constexpr auto fields = json_binding<M>::fields();
+    json_clear_members(fields, out);
+    while(reader.read()) {
+        switch(reader.node_type()) {
+            case json_node_type::end_object:
+                return true;
+            case json_node_type::field: {
+                bool found;
+                if(!json_bind_field(fields, reader.value(), reader, out, &found)) {
+                    return false;
+                }
+                if(!found && (!reader.read() || !json_skip_current(reader))) {
+                    return false;
+                }
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+    return false;
+}
+/// @brief Binds numbers to an integer type. Derive a json_bind_value<> specialization from this to support other integer types.
+/// @tparam T The integer type
+template <typename T>
+struct json_bind_integer {
+    static bool bind(json_reader_base& reader, T& out) {
+        bool assigned;
+        return bind(reader, out, &assigned);
+    }
+    static bool bind(json_reader_base& reader, T& out, bool* assigned) {
+        *assigned = false;
+        if(reader.node_type() == json_node_type::value) {
+            json_value_type vt = reader.value_type();
+            if(vt == json_value_type::integer || vt == json_value_type::real || vt == json_value_type::boolean) {
+                out = (T)reader.value_int();
+                *assigned = true;
+            }
+            return true;
+        }
+        return json_skip_current(reader);
+    }
+};
+/// @brief Binds numbers to a floating point type
+/// @tparam T The floating point type
+template <typename T>
+struct json_bind_real {
+    static bool bind(json_reader_base& reader, T& out) {
+        bool assigned;
+        return bind(reader, out, &assigned);
+    }
+    static bool bind(json_reader_base& reader, T& out, bool* assigned) {
+        *assigned = false;
+        if(reader.node_type() == json_node_type::value) {
+            json_value_type vt = reader.value_type();
+            if(vt == json_value_type::integer || vt == json_value_type::real) {
+                out = (T)reader.value_real();
+                *assigned = true;
+            }
+            return true;
+        }
+        return json_skip_current(reader);
+    }
+};
+template <>
+struct json_bind_value<char> : json_bind_integer<char> {};
+template <>
+struct json_bind_value<signed char> : json_bind_integer<signed char> {};
+template <>
+struct json_bind_value<unsigned char> : json_bind_integer<unsigned char> {};
+template <>
+struct json_bind_value<short> : json_bind_integer<short> {};
+template <>
+struct json_bind_value<unsigned short> : json_bind_integer<unsigned short> {};
+template <>
+struct json_bind_value<int> : json_bind_integer<int> {};
+template <>
+struct json_bind_value<unsigned int> : json_bind_integer<unsigned int> {};
+template <>
+struct json_bind_value<long> : json_bind_integer<long> {};
+template <>
+struct json_bind_value<unsigned long> : json_bind_integer<unsigned long> {};
+template <>
+struct json_bind_value<long long> : json_bind_integer<long long> {};
+template <>
+struct json_bind_value<unsigned long long> : json_bind_integer<unsigned long long> {};
+template <>
+struct json_bind_value<float> : json_bind_real<float> {};
+template <>
+struct json_bind_value<double> : json_bind_real<double> {};
+template <>
+struct json_bind_value<bool> {
+    static bool bind(json_reader_base& reader, bool& out) {
+        bool assigned;
+        return bind(reader, out, &assigned);
+    }
+    static bool bind(json_reader_base& reader, bool& out, bool* assigned) {
+        *assigned = false;
+        if(reader.node_type() == json_node_type::value) {
+            if(reader.value_type() != json_value_type::none && reader.value_type() != json_value_type::null) {
+                out = reader.value_bool();
+                *assigned = true;
+            }
+            return true;
+        }
+        return json_skip_current(reader);
+    }
+};
+/// @brief Binds strings (and the text of other scalars) to a fixed buffer, truncating if necessary
+template <size_t Size>
+struct json_bind_value<char[Size]> {
+    static bool bind(json_reader_base& reader, char (&out)[Size]) {
+        bool assigned;
+        return bind(reader, out, &assigned);
+    }
+    static bool bind(json_reader_base& reader, char (&out)[Size], bool* assigned) {
+        json_node_type nt = reader.node_type();
+        *assigned = nt == json_node_type::value || nt == json_node_type::value_part;
+        if(!*assigned) {
+            return json_skip_current(reader);
+        }
+        size_t len = 0;
+        while(true) {
+            const char* sz = reader.value();
+            size_t l = strlen(sz);
+            if(len + l >= Size) {
+                l = Size - 1 - len;
+            }
+            memcpy(out + len, sz, l);
+            len += l;
+            if(reader.node_type() != json_node_type::value_part) {
+                break;
+            }
+            if(!reader.read()) {
+                out[len] = 0;
+                return false;
+            }
+        }
+        out[len] = 0;
+        return true;
+    }
+};
+/// @brief Binds a JSON array to a fixed array. Missing elements are left untouched and extra elements are skipped.
+template <typename T, size_t Size>
+struct json_bind_value<T[Size]> {
+    static bool bind(json_reader_base& reader, T (&out)[Size]) {
+        bool assigned;
+        return bind(reader, out, &assigned);
+    }
+    static bool bind(json_reader_base& reader, T (&out)[Size], bool* assigned) {
+        *assigned = reader.node_type() == json_node_type::array;
+        if(!*assigned) {
+            return json_skip_current(reader);
+        }
+        size_t i = 0;
+        while(reader.read()) {
+            if(reader.node_type() == json_node_type::end_array) {
+                return true;
+            }
+            if(i < Size) {
+                if(!json_bind_value<T>::bind(reader, out[i++])) {
+                    return false;
+                }
+            } else if(!json_skip_current(reader)) {
+                return false;
+            }
+        }
+        return false;
+    }
+};
+template <typename T, size_t Capacity>
+struct json_bind_value<json_array<T, Capacity>> {
+    static bool bind(json_reader_base& reader, json_array<T, Capacity>& out) {
+        bool assigned;
+        return bind(reader, out, &assigned);
+    }
+    static bool bind(json_reader_base& reader, json_array<T, Capacity>& out, bool* assigned) {
+        out.size = 0;
+        *assigned = reader.node_type() == json_node_type::array;
+        if(!*assigned) {
+            return json_skip_current(reader);
+        }
+        while(reader.read()) {
+            if(reader.node_type() == json_node_type::end_array) {
+                return true;
+            }
+            if(out.size < Capacity) {
+                if(!json_bind_value<T>::bind(reader, out.items[out.size++])) {
+                    return false;
+                }
+            } else if(!json_skip_current(reader)) {
+                return false;
+            }
+        }
+        return false;
+    }
+};
+template <typename T>
+struct json_bind_value<json_optional<T>> {
+    static bool bind(json_reader_base& reader, json_optional<T>& out) {
+        out.has_value = false;
+        if(reader.node_type() == json_node_type::value && reader.value_type() == json_value_type::null) {
+            return true;
+        }
+        // a value of the wrong shape is skipped and leaves value untouched
+        bool assigned = false;
+        bool result = json_bind_assigned(reader, out.value, &assigned, 0);
+        out.has_value = result && assigned;
+        return result;
+    }
+};
+/// @brief Binds the value under the cursor to the specified struct or value
+/// @details Use this when the reader is already on the value, such as an element while iterating an array
+/// @tparam T The type to bind. Structs need a json_binding<T> specialization.
+/// @param reader The reader, positioned on the first node of the value
+/// @param out The struct or value to fill
+/// @return True if successful, otherwise false
+template <typename T>
+bool json_bind_current(json_reader_base& reader, T& out) {
+    bool raw = reader.raw_strings();
+    reader.raw_strings(false);
+    bool result = json_bind_value<T>::bind(reader, out);
+    reader.raw_strings(raw);
+    return result && reader.error() == json_error::none;
+}
+/// @brief Reads the next value and binds it to the specified struct or value
+/// @tparam T The type to bind. Structs need a json_binding<T> specialization.
+/// @param reader The reader
+/// @param out The struct or value to fill
+/// @return True if successful, otherwise false
+template <typename T>
+bool json_bind(json_reader_base& reader, T& out) {
+    if(!reader.read()) {
+        return false;
+    }
+    return json_bind_current(reader, out);
+}
+}
+#endif // HTCW_JSON_BIND_HPP
@@ -0,0 +1,861 @@
+#ifndef HTCW_JSON_CANONICAL_HPP
+#define HTCW_JSON_CANONICAL_HPP
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "json.hpp"
+#include "json_fanout.hpp"
+namespace json {
+/// @brief Indicates why a document could not be canonicalized
+enum struct json_canonical_error {
+    none = 0,
+    /// @brief An object, or a string longer than the reader's capture buffer, did not fit in the buffer
+    out_of_space,
+    /// @brief The open objects have more members between them than can be sorted
+    too_many_members,
+    /// @brief The document is nested too deeply
+    nesting_too_deep,
+    /// @brief An object has the same key more than once
+    duplicate_key,
+    /// @brief A number can't be represented, such as NaN or infinity
+    invalid_number,
+    /// @brief The reader reports raw strings. The canonicalizer needs them decoded.
+    raw_strings,
+    /// @brief The reader reported an error
+    reader,
+    /// @brief The output stream could not be written
+    output
+};
+/// @brief Computes a 64-bit XXH64 hash incrementally
+class json_xxh64 final {
+    constexpr static const uint64_t p1 = 0x9E3779B185EBCA87ULL;
+    constexpr static const uint64_t p2 = 0xC2B2AE3D27D4EB4FULL;
+    constexpr static const uint64_t p3 = 0x165667B19E3779F9ULL;
+    constexpr static const uint64_t p4 = 0x85EBCA77C2B2AE63ULL;
+    constexpr static const uint64_t p5 = 0x27D4EB2F165667C5ULL;
+    uint64_t m_acc[4];
+    uint64_t m_seed;
+    unsigned long long m_total;
+    uint8_t m_buffer[32];
+    size_t m_size;
+    static uint64_t rotl(uint64_t value, int bits) {
+        return (value << bits) | (value >> (64 - bits));
+    }
+    static uint64_t read64(const uint8_t* p) {
+        uint64_t result = 0;
+        for(int i = 7; i >= 0; --i) {
+            result = (result << 8) | p[i];
+        }
+        return result;
+    }
+    static uint32_t read32(const uint8_t* p) {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+    static uint64_t round(uint64_t acc, uint64_t input) {
+        acc += input * p2;
+        acc = rotl(acc, 31);
+        return acc * p1;
+    }
+    static uint64_t merge(uint64_t acc, uint64_t value) {
+        acc ^= round(0, value);
+        return acc * p1 + p4;
+    }
+    void stripe(const uint8_t* p) {
+        m_acc[0] = round(m_acc[0], read64(p));
+        m_acc[1] = round(m_acc[1], read64(p + 8));
+        m_acc[2] = round(m_acc[2], read64(p + 16));
+        m_acc[3] = round(m_acc[3], read64(p + 24));
+    }
+public:
+    /// @brief Constructs the hash
+    /// @param seed The seed
+    json_xxh64(uint64_t seed = 0) {
+        reset(seed);
+    }
+    /// @brief Starts a new hash
+    /// @param seed The seed
+    void reset(uint64_t seed = 0) {
+        m_seed = seed;
+        m_acc[0] = seed + p1 + p2;
+        m_acc[1] = seed + p2;
+        m_acc[2] = seed;
+        m_acc[3] = seed - p1;
+        m_total = 0;
+        m_size = 0;
+    }
+    /// @brief Adds data to the hash
+    /// @param data The data
+    /// @param size The size of the data in bytes
+    void update(const void* data, size_t size) {
+        const uint8_t* p = (const uint8_t*)data;
+        m_total += size;
+        if(m_size > 0) {
+            size_t run = sizeof(m_buffer) - m_size;
+            if(run > size) {
+                run = size;
+            }
+            memcpy(m_buffer + m_size, p, run);
+            m_size += run;
+            p += run;
+            size -= run;
+            if(m_size < sizeof(m_buffer)) {
+                return;
+            }
+            stripe(m_buffer);
+            m_size = 0;
+        }
+        while(size >= 32) {
+            stripe(p);
+            p += 32;
+            size -= 32;
+        }
+        memcpy(m_buffer, p, size);
+        m_size = size;
+    }
+    /// @brief Computes the hash of everything added so far. More can still be added afterward.
+    /// @return The hash
+    uint64_t digest() const {
+        uint64_t h;
+        if(m_total >= 32) {
+            h = rotl(m_acc[0], 1) + rotl(m_acc[1], 7) + rotl(m_acc[2], 12) + rotl(m_acc[3], 18);
+            h = merge(h, m_acc[0]);
+            h = merge(h, m_acc[1]);
+            h = merge(h, m_acc[2]);
+            h = merge(h, m_acc[3]);
+        } else {
+            h = m_seed + p5;
+        }
+        h += (uint64_t)m_total;
+        const uint8_t* p = m_buffer;
+        const uint8_t* end = m_buffer + m_size;
+        while(end - p >= 8) {
+            h ^= round(0, read64(p));
+            h = rotl(h, 27) * p1 + p4;
+            p += 8;
+        }
+        if(end - p >= 4) {
+            h ^= (uint64_t)read32(p) * p1;
+            h = rotl(h, 23) * p2 + p3;
+            p += 4;
+        }
+        while(p < end) {
+            h ^= *p++ * p5;
+            h = rotl(h, 11) * p1;
+        }
+        h ^= h >> 33;
+        h *= p2;
+        h ^= h >> 29;
+        h *= p3;
+        h ^= h >> 32;
+        return h;
+    }
+};
+/// @brief Computes a SHA-256 digest incrementally
+class json_sha256 final {
+    uint32_t m_state[8];
+    unsigned long long m_total;
+    uint8_t m_buffer[64];
+    size_t m_size;
+    static uint32_t rotr(uint32_t value, int bits) {
+        return (value >> bits) | (value << (32 - bits));
+    }
+    static void block(uint32_t* state, const uint8_t* p) {
+        static const uint32_t k[] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+        uint32_t w[64];
+        for(int i = 0; i < 16; ++i) {
+            w[i] = ((uint32_t)p[i * 4] << 24) | ((uint32_t)p[i * 4 + 1] << 16) | ((uint32_t)p[i * 4 + 2] << 8) | p[i * 4 + 3];
+        }
+        for(int i = 16; i < 64; ++i) {
+            uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for(int i = 0; i < 64; ++i) {
+            uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + k[i] + w[i];
+            uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+public:
+    /// @brief The size of a digest in bytes
+    constexpr static const size_t digest_size = 32;
+    /// @brief Constructs the hash
+    json_sha256() {
+        reset();
+    }
+    /// @brief Starts a new hash
+    void reset() {
+        static const uint32_t initial[] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+        memcpy(m_state, initial, sizeof(m_state));
+        m_total = 0;
+        m_size = 0;
+    }
+    /// @brief Adds data to the hash
+    /// @param data The data
+    /// @param size The size of the data in bytes
+    void update(const void* data, size_t size) {
+        const uint8_t* p = (const uint8_t*)data;
+        m_total += size;
+        while(size > 0) {
+            if(m_size == 0 && size >= sizeof(m_buffer)) {
+                block(m_state, p);
+                p += sizeof(m_buffer);
+                size -= sizeof(m_buffer);
+                continue;
+            }
+            size_t run = sizeof(m_buffer) - m_size;
+            if(run > size) {
+                run = size;
+            }
+            memcpy(m_buffer + m_size, p, run);
+            m_size += run;
+            p += run;
+            size -= run;
+            if(m_size == sizeof(m_buffer)) {
+                block(m_state, m_buffer);
+                m_size = 0;
+            }
+        }
+    }
+    /// @brief Computes the digest of everything added so far. More can still be added afterward.
+    /// @param digest Receives the 32 byte digest
+    void digest(uint8_t* digest) const {
+        uint32_t state[8];
+        uint8_t buffer[128];
+        memcpy(state, m_state, sizeof(state));
+        memcpy(buffer, m_buffer, m_size);
+        size_t size = m_size;
+        buffer[size++] = 0x80;
+        size_t padded = size <= 56 ? 64 : 128;
+        memset(buffer + size, 0, padded - size);
+        unsigned long long bits = m_total * 8;
+        for(int i = 0; i < 8; ++i) {
+            buffer[padded - 1 - i] = (uint8_t)(bits >> (i * 8));
+        }
+        block(state, buffer);
+        if(padded == 128) {
+            block(state, buffer + 64);
+        }
+        for(int i = 0; i < 8; ++i) {
+            digest[i * 4] = (uint8_t)(state[i] >> 24);
+            digest[i * 4 + 1] = (uint8_t)(state[i] >> 16);
+            digest[i * 4 + 2] = (uint8_t)(state[i] >> 8);
+            digest[i * 4 + 3] = (uint8_t)state[i];
+        }
+    }
+};
+namespace {
+    // stands in for the SHA-256 when it isn't wanted
+    struct json_no_digest {
+        void reset() {
+        }
+        void update(const void*, size_t) {
+        }
+    };
+    // formats a number the way ECMAScript's Number.prototype.toString() does, as
+    // RFC 8785 requires. returns the length, or 0 for NaN and infinity
+    inline size_t json_canonical_number(double value, char* buffer) {
+        if(value != value || value - value != 0.0) {
+            return 0;
+        }
+        char* out = buffer;
+        if(value == 0.0) {
+            // including -0
+            *out++ = '0';
+            return 1;
+        }
+        if(value < 0) {
+            *out++ = '-';
+            value = -value;
+        }
+        // find the fewest significant digits that read back the same. if some
+        // number of digits reads back, so does every larger number
+        char text[32];
+        int low = 1;
+        int high = 17;
+        while(low < high) {
+            int mid = (low + high) / 2;
+            snprintf(text, sizeof(text), "%.*e", mid - 1, value);
+            if(strtod(text, nullptr) == value) {
+                high = mid;
+            } else {
+                low = mid + 1;
+            }
+        }
+        snprintf(text, sizeof(text), "%.*e", low - 1, value);
+        // split into the digits and the decimal exponent
+        char digits[20];
+        int count = 0;
+        const char* p = text;
+        for(; *p != 'e'; ++p) {
+            if(*p != '.') {
+                digits[count++] = *p;
+            }
+        }
+        int n = atoi(p + 1) + 1;
+        while(count > 1 && digits[count - 1] == '0') {
+            --count;
+        }
+        if(count <= n && n <= 21) {
+            // an integer
+            memcpy(out, digits, count);
+            out += count;
+            for(int i = count; i < n; ++i) {
+                *out++ = '0';
+            }
+        } else if(0 < n && n <= 21) {
+            memcpy(out, digits, n);
+            out += n;
+            *out++ = '.';
+            memcpy(out, digits + n, count - n);
+            out += count - n;
+        } else if(-6 < n && n <= 0) {
+            *out++ = '0';
+            *out++ = '.';
+            for(int i = n; i < 0; ++i) {
+                *out++ = '0';
+            }
+            memcpy(out, digits, count);
+            out += count;
+        } else {
+            *out++ = digits[0];
+            if(count > 1) {
+                *out++ = '.';
+                memcpy(out, digits + 1, count - 1);
+                out += count - 1;
+            }
+            out += sprintf(out, "e%c%d", n - 1 < 0 ? '-' : '+', n - 1 < 0 ? 1 - n : n - 1);
+        }
+        return out - buffer;
+    }
+    // walks a canonical string, starting at its opening quote, as UTF-16 code units
+    class json_canonical_units {
+        const uint8_t* m_p;
+        int m_low;
+    public:
+        json_canonical_units(const uint8_t* p) : m_p(p + 1), m_low(-1) {
+        }
+        // returns the next code unit, or -1 at the closing quote
+        int next() {
+            if(m_low != -1) {
+                int result = m_low;
+                m_low = -1;
+                return result;
+            }
+            uint8_t ch = *m_p++;
+            if(ch == '\"') {
+                return -1;
+            }
+            if(ch == '\\') {
+                ch = *m_p++;
+                switch(ch) {
+                    case 'b':
+                        return '\b';
+                    case 'f':
+                        return '\f';
+                    case 'n':
+                        return '\n';
+                    case 'r':
+                        return '\r';
+                    case 't':
+                        return '\t';
+                    case 'u': {
+                        // only control characters are written this way
+                        char hex[5];
+                        memcpy(hex, m_p, 4);
+                        hex[4] = 0;
+                        m_p += 4;
+                        return (int)strtol(hex, nullptr, 16);
+                    }
+                    default:
+                        return ch;
+                }
+            }
+            if(ch < 0x80) {
+                return ch;
+            }
+            uint32_t cp;
+            int extra;
+            if(ch >= 0xF0) {
+                cp = ch & 0x07;
+                extra = 3;
+            } else if(ch >= 0xE0) {
+                cp = ch & 0x0F;
+                extra = 2;
+            } else {
+                cp = ch & 0x1F;
+                extra = 1;
+            }
+            while(extra-- > 0) {
+                cp = (cp << 6) | (*m_p++ & 0x3F);
+            }
+            if(cp >= 0x10000) {
+                cp -= 0x10000;
+                m_low = 0xDC00 | (cp & 0x3FF);
+                return 0xD800 | (int)(cp >> 10);
+            }
+            return (int)cp;
+        }
+    };
+    // compares two canonical strings by their UTF-16 code units, as RFC 8785 sorts keys
+    inline int json_canonical_compare(const uint8_t* lhs, const uint8_t* rhs) {
+        json_canonical_units l(lhs);
+        json_canonical_units r(rhs);
+        while(true) {
+            int a = l.next();
+            int b = r.next();
+            if(a != b) {
+                return a < b ? -1 : 1;
+            }
+            if(a == -1) {
+                return 0;
+            }
+        }
+    }
+}
+/// @brief Writes documents in canonical form, after RFC 8785 (JCS), and hashes them, so documents that differ only in whitespace, key order, escapes or number formatting hash the same
+/// @details Driven by the nodes of a reader, directly through run() or as a consumer of a json_fanout_ex. Object members are sorted by key, strings use the fewest escapes, and numbers are written the way ECMAScript would write them.
+/// Only objects need buffering, since their members are sorted before they're written. Everything from the start of the outermost open object is held in the buffer, and closing an object needs free space for another copy of it. A string longer than the reader's capture buffer must also fit while it's read.
+/// @tparam Capacity The size of the buffer in bytes
+/// @tparam MaxMembers The maximum number of members of all open objects combined
+/// @tparam MaxDepth The maximum combined nesting of arrays and objects
+/// @tparam Sha256 True to also compute a SHA-256 digest
+template <size_t Capacity = 1024, size_t MaxMembers = 64, size_t MaxDepth = 32, bool Sha256 = false>
+class json_canonicalizer_ex final : public json_consumer {
+    static_assert(Capacity >= 64, "Capacity must be at least 64");
+    using sha_type = typename json_conditional<Sha256, json_sha256, json_no_digest>::type;
+    struct frame {
+        // where the object's first member starts in the buffer
+        size_t start;
+        // the index of the object's first member
+        size_t first;
+        bool object;
+        // an array already has an element
+        bool any;
+    };
+    struct member {
+        size_t start;
+        size_t size;
+    };
+    stream* m_output;
+    json_xxh64 m_hash;
+    sha_type m_sha;
+    unsigned long long m_total;
+    json_canonical_error m_error;
+    size_t m_size;
+    size_t m_depth;
+    size_t m_objects;
+    size_t m_members;
+    // where the string of a pending value_part starts
+    size_t m_part;
+    bool m_in_part;
+    bool m_complete;
+    frame m_frames[MaxDepth];
+    member m_member[MaxMembers];
+    uint8_t m_buffer[Capacity];
+    json_canonicalizer_ex(const json_canonicalizer_ex& rhs) = delete;
+    json_canonicalizer_ex& operator=(const json_canonicalizer_ex& rhs) = delete;
+    bool fail(json_canonical_error error) {
+        if(m_error == json_canonical_error::none) {
+            m_error = error;
+        }
+        return false;
+    }
+    bool buffered() const {
+        return m_objects > 0 || m_in_part;
+    }
+    bool emit(const uint8_t* data, size_t size) {
+        m_hash.update(data, size);
+        m_sha.update(data, size);
+        m_total += size;
+        if(m_output != nullptr && m_output->write(data, size) != size) {
+            return fail(json_canonical_error::output);
+        }
+        return true;
+    }
+    bool flush() {
+        bool result = emit(m_buffer, m_size);
+        m_size = 0;
+        return result;
+    }
+    bool put(const void* data, size_t size) {
+        if(m_size + size > Capacity) {
+            if(buffered()) {
+                return fail(json_canonical_error::out_of_space);
+            }
+            if(!flush()) {
+                return false;
+            }
+            if(size > Capacity) {
+                return emit((const uint8_t*)data, size);
+            }
+        }
+        memcpy(m_buffer + m_size, data, size);
+        m_size += size;
+        return true;
+    }
+    bool put(uint8_t ch) {
+        return put(&ch, 1);
+    }
+    // writes string content with the fewest escapes, as RFC 8785 requires
+    bool put_escaped(const char* sz) {
+        const char* run = sz;
+        while(*sz) {
+            unsigned char ch = (unsigned char)*sz;
+            if(ch >= 0x20 && ch != '\"' && ch != '\\') {
+                ++sz;
+                continue;
+            }
+            if(!put(run, sz - run)) {
+                return false;
+            }
+            char buf[8];
+            switch(ch) {
+                case '\"':
+                case '\\':
+                    buf[0] = '\\';
+                    buf[1] = (char)ch;
+                    buf[2] = 0;
+                    break;
+                case '\b':
+                    memcpy(buf, "\\b", 3);
+                    break;
+                case '\f':
+                    memcpy(buf, "\\f", 3);
+                    break;
+                case '\n':
+                    memcpy(buf, "\\n", 3);
+                    break;
+                case '\r':
+                    memcpy(buf, "\\r", 3);
+                    break;
+                case '\t':
+                    memcpy(buf, "\\t", 3);
+                    break;
+                default:
+                    snprintf(buf, sizeof(buf), "\\u%04x", ch);
+                    break;
+            }
+            if(!put(buf, strlen(buf))) {
+                return false;
+            }
+            run = ++sz;
+        }
+        return put(run, sz - run);
+    }
+    // writes a number from its text, which strtod() rounds correctly
+    bool put_number(const char* text) {
+        char buf[32];
+        size_t size = json_canonical_number(strtod(text, nullptr), buf);
+        if(size == 0) {
+            return fail(json_canonical_error::invalid_number);
+        }
+        return put(buf, size);
+    }
+    bool put_scalar(const json_reader_base& reader, const char* text) {
+        switch(reader.value_type()) {
+            case json_value_type::null:
+                return put("null", 4);
+            case json_value_type::boolean:
+                return reader.value_bool() ? put("true", 4) : put("false", 5);
+            case json_value_type::integer: {
+                long long value = reader.value_int();
+                // beyond 2^53, integers are written as the double they read as
+                if(value >= -9007199254740992LL && value <= 9007199254740992LL) {
+                    char buf[32];
+                    return put(buf, snprintf(buf, sizeof(buf), "%lld", value));
+                }
+                return put_number(text);
+            }
+            case json_value_type::real:
+                return put_number(text);
+            default:
+                if(!put('\"') || !put_escaped(text)) {
+                    return false;
+                }
+                return put('\"');
+        }
+    }
+    // called before anything that starts a value
+    bool begin_value() {
+        if(m_depth > 0) {
+            frame& f = m_frames[m_depth - 1];
+            if(!f.object) {
+                if(f.any && !put(',')) {
+                    return false;
+                }
+                f.any = true;
+            }
+        }
+        return true;
+    }
+    // called after anything that ends a value
+    bool end_value() {
+        if(m_depth == 0) {
+            m_complete = true;
+            return flush();
+        }
+        if(!buffered() && m_size >= Capacity / 2) {
+            return flush();
+        }
+        return true;
+    }
+    // sorts the members of the innermost object and writes it out in their place
+    bool close_object() {
+        frame& f = m_frames[m_depth - 1];
+        size_t count = m_members - f.first;
+        member* members = m_member + f.first;
+        if(count == 0) {
+            return put("{}", 2);
+        }
+        size_t out_size = (m_size - f.start) + count + 1;
+        if(m_size + out_size > Capacity) {
+            return fail(json_canonical_error::out_of_space);
+        }
+        for(size_t i = 0; i < count; ++i) {
+            members[i].size = (i + 1 < count ? members[i + 1].start : m_size) - members[i].start;
+        }
+        // binary insertion sort. the compares are the costly part
+        for(size_t i = 1; i < count; ++i) {
+            member m = members[i];
+            size_t low = 0;
+            size_t high = i;
+            while(low < high) {
+                size_t mid = (low + high) / 2;
+                int cmp = json_canonical_compare(m_buffer + m.start, m_buffer + members[mid].start);
+                if(cmp == 0) {
+                    return fail(json_canonical_error::duplicate_key);
+                }
+                if(cmp < 0) {
+                    high = mid;
+                } else {
+                    low = mid + 1;
+                }
+            }
+            memmove(members + low + 1, members + low, (i - low) * sizeof(member));
+            members[low] = m;
+        }
+        // build the object after the members, then move it over them
+        uint8_t* out = m_buffer + m_size;
+        *out++ = '{';
+        for(size_t i = 0; i < count; ++i) {
+            if(i > 0) {
+                *out++ = ',';
+            }
+            memcpy(out, m_buffer + members[i].start, members[i].size);
+            out += members[i].size;
+        }
+        *out++ = '}';
+        memmove(m_buffer + f.start, m_buffer + m_size, out_size);
+        m_size = f.start + out_size;
+        m_members = f.first;
+        return true;
+    }
+    bool push(bool object) {
+        if(m_depth == MaxDepth) {
+            return fail(json_canonical_error::nesting_too_deep);
+        }
+        if(object && !buffered() && m_size > 0 && !flush()) {
+            // the outermost object gets the whole buffer
+            return false;
+        }
+        frame& f = m_frames[m_depth++];
+        f.start = m_size;
+        f.first = m_members;
+        f.object = object;
+        f.any = false;
+        if(object) {
+            ++m_objects;
+        }
+        return true;
+    }
+    bool process(const json_reader_base& reader) {
+        if(reader.raw_strings()) {
+            return fail(json_canonical_error::raw_strings);
+        }
+        switch(reader.node_type()) {
+            case json_node_type::array:
+                return begin_value() && push(false) && put('[');
+            case json_node_type::object:
+                return begin_value() && push(true);
+            case json_node_type::end_array:
+                --m_depth;
+                return put(']') && end_value();
+            case json_node_type::end_object:
+                if(!close_object()) {
+                    return false;
+                }
+                --m_objects;
+                --m_depth;
+                return end_value();
+            case json_node_type::field:
+                if(m_members == MaxMembers) {
+                    return fail(json_canonical_error::too_many_members);
+                }
+                m_member[m_members++].start = m_size;
+                return put('\"') && put_escaped(reader.value()) && put("\":", 2);
+            case json_node_type::value:
+                return begin_value() && put_scalar(reader, reader.value()) && end_value();
+            case json_node_type::value_part:
+                if(!m_in_part) {
+                    // the type isn't known until the end, so it's held as a
+                    // string. numbers and literals need no escapes
+                    if(!begin_value()) {
+                        return false;
+                    }
+                    m_in_part = true;
+                    m_part = m_size;
+                    if(!put('\"')) {
+                        return false;
+                    }
+                }
+                return put_escaped(reader.value());
+            case json_node_type::end_value_part:
+                if(!put_escaped(reader.value())) {
+                    return false;
+                }
+                if(reader.value_type() == json_value_type::none) {
+                    if(!put('\"')) {
+                        return false;
+                    }
+                } else {
+                    // terminate the text held so far, to read the number from it
+                    if(!put('\0')) {
+                        return false;
+                    }
+                    const char* text = (const char*)m_buffer + m_part + 1;
+                    // the text is read before anything is written over it
+                    m_size = m_part;
+                    if(!put_scalar(reader, text)) {
+                        return false;
+                    }
+                }
+                m_in_part = false;
+                return end_value();
+            case json_node_type::error:
+                return fail(json_canonical_error::reader);
+            default:
+                return true;
+        }
+    }
+public:
+    /// @brief The buffer size
+    constexpr static const size_t capacity = Capacity;
+    /// @brief Constructs the canonicalizer
+    /// @param output If not null, receives the canonical text
+    /// @param seed The seed for the XXH64 hash
+    json_canonicalizer_ex(stream* output = nullptr, uint64_t seed = 0) : m_output(output) {
+        reset(seed);
+    }
+    /// @brief Starts over for another document
+    /// @param seed The seed for the XXH64 hash
+    void reset(uint64_t seed = 0) {
+        m_hash.reset(seed);
+        m_sha.reset();
+        m_total = 0;
+        m_error = json_canonical_error::none;
+        m_size = 0;
+        m_depth = 0;
+        m_objects = 0;
+        m_members = 0;
+        m_part = 0;
+        m_in_part = false;
+        m_complete = false;
+    }
+    /// @brief Receives a node. Stops on error.
+    /// @param reader The reader, positioned on the node
+    /// @return What the canonicalizer wants next
+    virtual json_consumer_action node(const json_reader_base& reader) override {
+        if(m_error != json_canonical_error::none || m_complete) {
+            return json_consumer_action::stop;
+        }
+        if(!process(reader)) {
+            return json_consumer_action::stop;
+        }
+        return m_complete ? json_consumer_action::stop : json_consumer_action::next;
+    }
+    /// @brief Reads the rest of the document and canonicalizes it
+    /// @param reader The reader
+    /// @return True if the whole document was canonicalized, otherwise false
+    bool run(json_reader_base& reader) {
+        while(!m_complete && m_error == json_canonical_error::none && reader.read()) {
+            process(reader);
+        }
+        if(reader.error() != json_error::none || !m_complete) {
+            // including a document that ends early
+            fail(json_canonical_error::reader);
+        }
+        return complete();
+    }
+    /// @brief Indicates whether a whole document has been canonicalized
+    /// @return True if the document is complete and there was no error
+    bool complete() const {
+        return m_complete && m_error == json_canonical_error::none;
+    }
+    /// @brief Indicates the error, if any
+    /// @return The error
+    json_canonical_error error() const {
+        return m_error;
+    }
+    /// @brief Indicates the size of the canonical text written so far
+    /// @return The size in bytes
+    unsigned long long size() const {
+        return m_total;
+    }
+    /// @brief The XXH64 hash of the canonical text written so far
+    /// @return The hash
+    uint64_t hash() const {
+        return m_hash.digest();
+    }
+    /// @brief The SHA-256 digest of the canonical text written so far. Only available when Sha256 is true.
+    /// @param digest Receives the 32 byte digest
+    void sha256(uint8_t* digest) const {
+        static_assert(Sha256, "Sha256 must be true");
+        m_sha.digest(digest);
+    }
+};
+using json_canonicalizer = json_canonicalizer_ex<>;
+/// @brief Canonicalizes the rest of a document and returns its XXH64 hash
+/// @tparam Capacity The size of the buffer in bytes
+/// @tparam MaxMembers The maximum number of members of all open objects combined
+/// @tparam MaxDepth The maximum combined nesting of arrays and objects
+/// @param reader The reader
+/// @param out_hash Receives the hash
+/// @param seed The seed for the hash
+/// @return The error, if any
+template <size_t Capacity = 1024, size_t MaxMembers = 64, size_t MaxDepth = 32>
+json_canonical_error json_canonical_hash(json_reader_base& reader, uint64_t* out_hash, uint64_t seed = 0) {
+    json_canonicalizer_ex<Capacity, MaxMembers, MaxDepth> canonicalizer(nullptr, seed);
+    canonicalizer.run(reader);
+    *out_hash = canonicalizer.hash();
+    return canonicalizer.error();
+}
+}
+#endif // HTCW_JSON_CANONICAL_HPP
@@ -0,0 +1,789 @@
+#ifndef HTCW_JSON_CBOR_HPP
+#define HTCW_JSON_CBOR_HPP
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "json.hpp"
+namespace json {
+namespace {
+    // CBOR (RFC 8949) major types
+    constexpr static const uint8_t cbor_major_uint = 0;
+    constexpr static const uint8_t cbor_major_nint = 1;
+    constexpr static const uint8_t cbor_major_bytes = 2;
+    constexpr static const uint8_t cbor_major_text = 3;
+    constexpr static const uint8_t cbor_major_array = 4;
+    constexpr static const uint8_t cbor_major_map = 5;
+    constexpr static const uint8_t cbor_major_tag = 6;
+    constexpr static const uint8_t cbor_major_simple = 7;
+    constexpr static const uint8_t cbor_indefinite = 31;
+    constexpr static const uint8_t cbor_break = 0xFF;
+    inline bool cbor_write_byte(stream& output, uint8_t value) {
+        return output.putch(value) != -1;
+    }
+    inline bool cbor_write_head(stream& output, uint8_t major, uint64_t value) {
+        uint8_t buf[9];
+        size_t len;
+        major <<= 5;
+        if(value < 24) {
+            buf[0] = major | (uint8_t)value;
+            len = 1;
+        } else if(value <= 0xFF) {
+            buf[0] = major | 24;
+            buf[1] = (uint8_t)value;
+            len = 2;
+        } else if(value <= 0xFFFF) {
+            buf[0] = major | 25;
+            buf[1] = (uint8_t)(value >> 8);
+            buf[2] = (uint8_t)value;
+            len = 3;
+        } else if(value <= 0xFFFFFFFF) {
+            buf[0] = major | 26;
+            for(int i = 0; i < 4; ++i) {
+                buf[4 - i] = (uint8_t)(value >> (i * 8));
+            }
+            len = 5;
+        } else {
+            buf[0] = major | 27;
+            for(int i = 0; i < 8; ++i) {
+                buf[8 - i] = (uint8_t)(value >> (i * 8));
+            }
+            len = 9;
+        }
+        return output.write(buf, len) == len;
+    }
+    inline bool cbor_write_text(stream& output, const char* text) {
+        size_t len = strlen(text);
+        if(!cbor_write_head(output, cbor_major_text, len)) {
+            return false;
+        }
+        return len == 0 || output.write((const uint8_t*)text, len) == len;
+    }
+    // writes one chunk of an indefinite length text string. the reader splits
+    // strings by byte count, but each chunk must be whole UTF-8 (RFC 8949
+    // 3.2.3), so an incomplete sequence at the end is carried to the next chunk
+    inline bool cbor_write_text_chunk(stream& output, const char* text, char* carry, size_t* carry_size, bool last) {
+        size_t len = strlen(text);
+        size_t total = *carry_size + len;
+        size_t hold = 0;
+        if(!last) {
+            // the last sequence is within the last four bytes of both together
+            uint8_t tail[4];
+            size_t n = total < 4 ? total : 4;
+            // the second bound keeps GCC's -Wstringop-overflow quiet
+            for(size_t i = 0; i < n && i < sizeof(tail); ++i) {
+                size_t at = total - n + i;
+                tail[i] = (uint8_t)(at < *carry_size ? carry[at] : text[at - *carry_size]);
+            }
+            size_t i = n;
+            while(i > 0 && (tail[i - 1] & 0xC0) == 0x80) {
+                --i;
+            }
+            if(i > 0) {
+                uint8_t lead = tail[i - 1];
+                size_t need = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 1;
+                if(n - (i - 1) < need) {
+                    hold = n - (i - 1);
+                }
+            }
+        }
+        size_t size = total - hold;
+        if(size > 0) {
+            size_t from_carry = size < *carry_size ? size : *carry_size;
+            if(!cbor_write_head(output, cbor_major_text, size) ||
+                output.write((const uint8_t*)carry, from_carry) != from_carry ||
+                output.write((const uint8_t*)text, size - from_carry) != size - from_carry) {
+                return false;
+            }
+        }
+        char next[4];
+        for(size_t i = 0; i < hold; ++i) {
+            size_t at = size + i;
+            next[i] = at < *carry_size ? carry[at] : text[at - *carry_size];
+        }
+        memcpy(carry, next, hold);
+        *carry_size = hold;
+        return true;
+    }
+    inline bool cbor_write_real(stream& output, double value) {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        uint8_t buf[9];
+        buf[0] = (cbor_major_simple << 5) | 27;
+        for(int i = 0; i < 8; ++i) {
+            buf[8 - i] = (uint8_t)(bits >> (i * 8));
+        }
+        return output.write(buf, sizeof(buf)) == sizeof(buf);
+    }
+    inline bool cbor_write_value(stream& output, const json_reader_base& reader) {
+        switch(reader.value_type()) {
+            case json_value_type::null:
+                return cbor_write_byte(output, (cbor_major_simple << 5) | 22);
+            case json_value_type::boolean:
+                return cbor_write_byte(output, (cbor_major_simple << 5) | (reader.value_bool() ? 21 : 20));
+            case json_value_type::integer: {
+                long long i = reader.value_int();
+                if(i < 0) {
+                    return cbor_write_head(output, cbor_major_nint, (uint64_t)(-1 - i));
+                }
+                return cbor_write_head(output, cbor_major_uint, (uint64_t)i);
+            }
+            case json_value_type::real:
+                return cbor_write_real(output, reader.value_real());
+            default:
+                return cbor_write_text(output, reader.value());
+        }
+    }
+}
+/// @brief Transcodes the remaining nodes of a JSON reader into CBOR (RFC 8949)
+/// @details Arrays, objects and strings that arrive as value parts are written as indefinite length items, so the transcoder never buffers. Each chunk of such a string is whole UTF-8. Numbers and literals longer than the capture keep their type. Strings are always decoded during transcoding.
+/// @param reader The reader to pull nodes from
+/// @param output The stream to write the CBOR data to
+/// @return True if the entire document was transcoded, otherwise false
+inline bool json_to_cbor(json_reader_base& reader, stream& output) {
+    bool raw = reader.raw_strings();
+    reader.raw_strings(false);
+    bool result = true;
+    while(result && reader.read()) {
+        switch(reader.node_type()) {
+            case json_node_type::array:
+                result = cbor_write_byte(output, (cbor_major_array << 5) | cbor_indefinite);
+                break;
+            case json_node_type::object:
+                result = cbor_write_byte(output, (cbor_major_map << 5) | cbor_indefinite);
+                break;
+            case json_node_type::end_array:
+            case json_node_type::end_object:
+                result = cbor_write_byte(output, cbor_break);
+                break;
+            case json_node_type::field:
+                result = cbor_write_text(output, reader.value());
+                break;
+            case json_node_type::value:
+                result = cbor_write_value(output, reader);
+                break;
+            case json_node_type::value_part:
+                if(!reader.is_string()) {
+                    // a number or literal longer than the capture. only its
+                    // typed value, which is known at the end, is written
+                    while(reader.read() && reader.node_type() == json_node_type::value_part);
+                    result = reader.node_type() == json_node_type::end_value_part && cbor_write_value(output, reader);
+                    break;
+                }
+                {
+                    char carry[4];
+                    size_t carry_size = 0;
+                    result = cbor_write_byte(output, (cbor_major_text << 5) | cbor_indefinite) &&
+                             cbor_write_text_chunk(output, reader.value(), carry, &carry_size, false);
+                    while(result && reader.read() && reader.node_type() == json_node_type::value_part) {
+                        result = cbor_write_text_chunk(output, reader.value(), carry, &carry_size, false);
+                    }
+                    if(result && reader.node_type() == json_node_type::end_value_part) {
+                        result = cbor_write_text_chunk(output, reader.value(), carry, &carry_size, true) &&
+                                 cbor_write_byte(output, cbor_break);
+                    } else {
+                        result = false;
+                    }
+                }
+                break;
+            default:
+                result = false;
+                break;
+        }
+    }
+    reader.raw_strings(raw);
+    return result && reader.error() == json_error::none;
+}
+/// @brief A JSON reader over CBOR data such as that produced by json_to_cbor()
+/// @tparam CaptureSize The size of the capture buffer. Numbers are formatted into it whole, so it must be at least 25 bytes.
+/// @tparam MaxDepth The maximum combined nesting of arrays and maps
+template <size_t CaptureSize = 1024, size_t MaxDepth = 64>
+class cbor_reader_ex : public json_reader_base {
+    // "-2.2250738585072014e-308" and the terminator
+    static_assert(CaptureSize >= 25, "CaptureSize must be at least 25 to hold a formatted number");
+public:
+    constexpr static const size_t capture_size = CaptureSize;
+    constexpr static const size_t max_depth = MaxDepth;
+private:
+    constexpr static const uint32_t indefinite_count = 0xFFFFFFFF;
+    stream* m_stream;
+    int m_state;
+    unsigned int m_depth;
+    int m_error;
+    json_value_type m_value_type;
+    bool m_raw_strings;
+    long long m_int;
+    double m_real;
+    // strings in progress
+    uint64_t m_str_remaining;
+    bool m_str_indefinite;
+    bool m_str_close_quote;
+    // numbers are only turned into text when value() is called
+    mutable bool m_text_pending;
+    mutable char m_capture[CaptureSize];
+    size_t m_capture_size;
+    // container stack
+    size_t m_level;
+    bool m_key_next;
+    uint32_t m_remaining[MaxDepth];
+    uint8_t m_maps[(MaxDepth + 7) / 8];
+    cbor_reader_ex(const cbor_reader_ex& rhs) = delete;
+    cbor_reader_ex& operator=(const cbor_reader_ex& rhs) = delete;
+    void do_move(cbor_reader_ex& rhs) {
+        m_stream = rhs.m_stream;
+        rhs.m_stream = nullptr;
+        m_state = rhs.m_state;
+        rhs.m_state = (int)json_node_type::error;
+        m_depth = rhs.m_depth;
+        m_error = rhs.m_error;
+        rhs.m_error = -1;
+        m_value_type = rhs.m_value_type;
+        m_raw_strings = rhs.m_raw_strings;
+        m_int = rhs.m_int;
+        m_real = rhs.m_real;
+        m_str_remaining = rhs.m_str_remaining;
+        m_str_indefinite = rhs.m_str_indefinite;
+        m_str_close_quote = rhs.m_str_close_quote;
+        m_text_pending = rhs.m_text_pending;
+        memcpy(m_capture, rhs.m_capture, sizeof(m_capture));
+        m_capture_size = rhs.m_capture_size;
+        m_level = rhs.m_level;
+        m_key_next = rhs.m_key_next;
+        memcpy(m_remaining, rhs.m_remaining, sizeof(m_remaining));
+        memcpy(m_maps, rhs.m_maps, sizeof(m_maps));
+    }
+    bool top_is_map() const {
+        return m_level > 0 && 0 != (m_maps[(m_level - 1) >> 3] & (1 << ((m_level - 1) & 7)));
+    }
+    bool push(bool map, uint32_t count) {
+        if(m_level == MaxDepth) {
+            m_error = (int)json_error::nesting_too_deep;
+            return false;
+        }
+        uint8_t mask = 1 << (m_level & 7);
+        if(map) {
+            m_maps[m_level >> 3] |= mask;
+        } else {
+            m_maps[m_level >> 3] &= ~mask;
+        }
+        m_remaining[m_level++] = count;
+        m_key_next = map;
+        return true;
+    }
+    void pop() {
+        if(top_is_map()) {
+            --m_depth;
+            m_state = (int)json_node_type::end_object;
+        } else {
+            m_state = (int)json_node_type::end_array;
+        }
+        --m_level;
+        m_key_next = top_is_map();
+    }
+    bool read_arg(uint8_t info, uint64_t* result) {
+        if(info < 24) {
+            *result = info;
+            return true;
+        }
+        size_t len;
+        switch(info) {
+            case 24: len = 1; break;
+            case 25: len = 2; break;
+            case 26: len = 4; break;
+            case 27: len = 8; break;
+            default:
+                m_error = (int)json_error::illegal_character;
+                return false;
+        }
+        uint64_t value = 0;
+        while(len--) {
+            int ch = m_stream->getch();
+            if(ch < 0) {
+                m_error = (int)json_error::unterminated_element;
+                return false;
+            }
+            value = (value << 8) | (uint8_t)ch;
+        }
+        *result = value;
+        return true;
+    }
+    // widens the bits into a float's, so it needs nothing from libm
+    static double from_half(uint16_t half) {
+        uint32_t exp = (half >> 10) & 0x1F;
+        uint32_t mant = half & 0x3FF;
+        uint32_t bits = (uint32_t)(half & 0x8000) << 16;
+        if(exp == 31) {
+            // infinity or NaN
+            bits |= 0x7F800000 | (mant << 13);
+        } else if(exp != 0) {
+            bits |= ((exp + 112) << 23) | (mant << 13);
+        } else if(mant != 0) {
+            // subnormal halves are normal floats
+            exp = 113;
+            while((mant & 0x400) == 0) {
+                mant <<= 1;
+                --exp;
+            }
+            bits |= (exp << 23) | ((mant & 0x3FF) << 13);
+        }
+        float result;
+        memcpy(&result, &bits, sizeof(result));
+        return result;
+    }
+    void set_literal(const char* text) {
+        size_t len = strlen(text);
+        memcpy(m_capture, text, len + 1);
+        m_capture_size = len;
+    }
+    void format_number() const {
+        if(m_value_type == json_value_type::integer) {
+            snprintf(m_capture, CaptureSize, "%lld", m_int);
+            return;
+        }
+        // use the shortest precision that round trips
+        snprintf(m_capture, CaptureSize, "%.15g", m_real);
+        if(strtod(m_capture, nullptr) != m_real) {
+            snprintf(m_capture, CaptureSize, "%.17g", m_real);
+        }
+    }
+    static size_t escape_size(uint8_t ch) {
+        if(ch == '\"' || ch == '\\' || ch == '\b' || ch == '\f' || ch == '\n' || ch == '\r' || ch == '\t') {
+            return 2;
+        }
+        return ch < 0x20 ? 6 : 1;
+    }
+    void capture_escaped(uint8_t ch) {
+        static const char* hex = "0123456789abcdef";
+        char* p = m_capture + m_capture_size;
+        switch(ch) {
+            case '\"': *p++ = '\\'; *p++ = '\"'; break;
+            case '\\': *p++ = '\\'; *p++ = '\\'; break;
+            case '\b': *p++ = '\\'; *p++ = 'b'; break;
+            case '\f': *p++ = '\\'; *p++ = 'f'; break;
+            case '\n': *p++ = '\\'; *p++ = 'n'; break;
+            case '\r': *p++ = '\\'; *p++ = 'r'; break;
+            case '\t': *p++ = '\\'; *p++ = 't'; break;
+            default:
+                if(ch < 0x20) {
+                    *p++ = '\\'; *p++ = 'u'; *p++ = '0'; *p++ = '0';
+                    *p++ = hex[ch >> 4];
+                    *p++ = hex[ch & 0xF];
+                } else {
+                    *p++ = (char)ch;
+                }
+                break;
+        }
+        m_capture_size = p - m_capture;
+    }
+    // fills the capture with string data. returns 1 when the string is
+    // complete, 0 when the capture is full, and -1 on error
+    int fill_string() {
+        const size_t capacity = CaptureSize - 1;
+        while(true) {
+            if(m_str_remaining == 0) {
+                if(m_str_indefinite) {
+                    int ch = m_stream->getch();
+                    if(ch < 0) {
+                        m_error = (int)json_error::unterminated_string;
+                        return -1;
+                    }
+                    if(ch == cbor_break) {
+                        m_str_indefinite = false;
+                        continue;
+                    }
+                    uint8_t major = ((uint8_t)ch) >> 5;
+                    if((major != cbor_major_text && major != cbor_major_bytes) || (ch & 31) == cbor_indefinite) {
+                        m_error = (int)json_error::illegal_character;
+                        return -1;
+                    }
+                    if(!read_arg(ch & 31, &m_str_remaining)) {
+                        return -1;
+                    }
+                    continue;
+                }
+                if(m_str_close_quote) {
+                    if(m_capture_size == capacity) {
+                        break;
+                    }
+                    m_capture[m_capture_size++] = '\"';
+                    m_str_close_quote = false;
+                }
+                m_capture[m_capture_size] = 0;
+                return 1;
+            }
+            if(m_raw_strings) {
+                // escaping may expand a byte so go one at a time
+                if(capacity - m_capture_size < 6) {
+                    break;
+                }
+                int ch = m_stream->getch();
+                if(ch < 0) {
+                    m_error = (int)json_error::unterminated_string;
+                    return -1;
+                }
+                capture_escaped((uint8_t)ch);
+                --m_str_remaining;
+                continue;
+            }
+            size_t room = capacity - m_capture_size;
+            if(room == 0) {
+                break;
+            }
+            if(room > m_str_remaining) {
+                room = (size_t)m_str_remaining;
+            }
+            size_t read = m_stream->read((uint8_t*)m_capture + m_capture_size, room);
+            if(read == 0) {
+                m_error = (int)json_error::unterminated_string;
+                return -1;
+            }
+            m_capture_size += read;
+            m_str_remaining -= read;
+        }
+        m_capture[m_capture_size] = 0;
+        return 0;
+    }
+    bool begin_string(uint8_t info) {
+        m_capture_size = 0;
+        m_str_remaining = 0;
+        m_str_indefinite = info == cbor_indefinite;
+        if(!m_str_indefinite && !read_arg(info, &m_str_remaining)) {
+            return false;
+        }
+        m_str_close_quote = m_raw_strings;
+        if(m_raw_strings) {
+            m_capture[m_capture_size++] = '\"';
+        }
+        return true;
+    }
+    bool read_item() {
+        while(true) {
+            int ib = m_stream->getch();
+            if(ib < 0) {
+                if(m_level == 0 && m_state != (int)json_node_type::initial) {
+                    m_state = (int)json_node_type::end_document;
+                } else {
+                    m_error = (int)json_error::unterminated_element;
+                }
+                return false;
+            }
+            if(m_level == 0 && m_state != (int)json_node_type::initial) {
+                // more than one root
+                m_error = (int)json_error::illegal_character;
+                return false;
+            }
+            if(ib == cbor_break) {
+                if(m_level == 0 || m_remaining[m_level - 1] != indefinite_count) {
+                    m_error = (int)json_error::illegal_character;
+                    return false;
+                }
+                if(top_is_map() && !m_key_next) {
+                    m_error = (int)json_error::field_missing_value;
+                    return false;
+                }
+                pop();
+                return true;
+            }
+            uint8_t major = ((uint8_t)ib) >> 5;
+            uint8_t info = ib & 31;
+            if(major == cbor_major_tag) {
+                // tags carry no meaning in JSON, so read the tagged item
+                uint64_t tag;
+                if(!read_arg(info, &tag)) {
+                    return false;
+                }
+                continue;
+            }
+            if(m_level > 0 && m_remaining[m_level - 1] != indefinite_count) {
+                --m_remaining[m_level - 1];
+            }
+            m_value_type = json_value_type::none;
+            m_text_pending = false;
+            if(top_is_map() && m_key_next) {
+                if((major != cbor_major_text && major != cbor_major_bytes) || !begin_string(info)) {
+                    if(m_error == 0) {
+                        m_error = (int)json_error::illegal_character;
+                    }
+                    return false;
+                }
+                int res = fill_string();
+                if(res < 0) {
+                    return false;
+                }
+                if(res == 0) {
+                    m_error = (int)json_error::field_too_long;
+                    return false;
+                }
+                m_key_next = false;
+                m_state = (int)json_node_type::field;
+                return true;
+            }
+            m_key_next = top_is_map();
+            uint64_t arg;
+            switch(major) {
+                case cbor_major_uint:
+                case cbor_major_nint:
+                    if(!read_arg(info, &arg)) {
+                        return false;
+                    }
+                    if(arg > 0x7FFFFFFFFFFFFFFFull) {
+                        // too big for a long long, so it's a real, as it would be from JSON text
+                        if(major == cbor_major_uint) {
+                            m_real = (double)arg;
+                        } else {
+                            // -1-arg, without arg+1 wrapping
+                            m_real = arg == 0xFFFFFFFFFFFFFFFFull ? -18446744073709551616.0 : -(double)(arg + 1);
+                        }
+                        m_int = 0;
+                        m_value_type = json_value_type::real;
+                    } else {
+                        m_int = major == cbor_major_uint ? (long long)arg : -1 - (long long)arg;
+                        m_real = (double)m_int;
+                        m_value_type = json_value_type::integer;
+                    }
+                    m_text_pending = true;
+                    m_state = (int)json_node_type::value;
+                    return true;
+                case cbor_major_bytes:
+                case cbor_major_text: {
+                    if(!begin_string(info)) {
+                        return false;
+                    }
+                    int res = fill_string();
+                    if(res < 0) {
+                        return false;
+                    }
+                    m_state = (int)(res ? json_node_type::value : json_node_type::value_part);
+                    return true;
+                }
+                case cbor_major_array:
+                case cbor_major_map:
+                    if(info == cbor_indefinite) {
+                        arg = indefinite_count;
+                    } else {
+                        if(!read_arg(info, &arg)) {
+                            return false;
+                        }
+                        if(major == cbor_major_map) {
+                            // a map holds a key and a value per entry
+                            if(arg > indefinite_count / 2) {
+                                m_error = (int)json_error::illegal_character;
+                                return false;
+                            }
+                            arg *= 2;
+                        }
+                        if(arg >= indefinite_count) {
+                            m_error = (int)json_error::illegal_character;
+                            return false;
+                        }
+                    }
+                    if(!push(major == cbor_major_map, (uint32_t)arg)) {
+                        return false;
+                    }
+                    if(major == cbor_major_map) {
+                        ++m_depth;
+                        m_state = (int)json_node_type::object;
+                    } else {
+                        m_state = (int)json_node_type::array;
+                    }
+                    return true;
+                default: // simple values and floats
+                    switch(info) {
+                        case 20:
+                        case 21:
+                            m_int = info == 21;
+                            m_value_type = json_value_type::boolean;
+                            set_literal(m_int ? "true" : "false");
+                            break;
+                        case 22:
+                        case 23:
+                            m_value_type = json_value_type::null;
+                            set_literal("null");
+                            break;
+                        case 25:
+                        case 26:
+                        case 27: {
+                            if(!read_arg(info, &arg)) {
+                                return false;
+                            }
+                            if(info == 25) {
+                                m_real = from_half((uint16_t)arg);
+                            } else if(info == 26) {
+                                uint32_t bits = (uint32_t)arg;
+                                float f;
+                                memcpy(&f, &bits, sizeof(f));
+                                m_real = f;
+                            } else {
+                                memcpy(&m_real, &arg, sizeof(m_real));
+                            }
+                            m_int = (long long)m_real;
+                            m_value_type = json_value_type::real;
+                            m_text_pending = true;
+                            break;
+                        }
+                        default:
+                            m_error = (int)json_error::illegal_literal;
+                            return false;
+                    }
+                    m_state = (int)json_node_type::value;
+                    return true;
+            }
+        }
+    }
+public:
+    /// @brief Constructs a reader over the specified stream
+    /// @param input The stream containing CBOR data
+    cbor_reader_ex(stream& input) : m_stream(&input), m_state((int)json_node_type::initial), m_depth(0), m_error(0), m_value_type(json_value_type::none), m_raw_strings(false), m_int(0), m_real(0.0), m_str_remaining(0), m_str_indefinite(false), m_str_close_quote(false), m_text_pending(false), m_capture_size(0), m_level(0), m_key_next(false) {
+        m_capture[0] = 0;
+    }
+    cbor_reader_ex() : m_stream(nullptr), m_state((int)json_node_type::error), m_depth(0), m_error(-1), m_value_type(json_value_type::none), m_raw_strings(false), m_int(0), m_real(0.0), m_str_remaining(0), m_str_indefinite(false), m_str_close_quote(false), m_text_pending(false), m_capture_size(0), m_level(0), m_key_next(false) {
+        m_capture[0] = 0;
+    }
+    cbor_reader_ex(cbor_reader_ex&& rhs) {
+        do_move(rhs);
+    }
+    cbor_reader_ex& operator=(cbor_reader_ex&& rhs) {
+        do_move(rhs);
+        return *this;
+    }
+    /// @brief The node type under the cursor
+    /// @return A json_node_type indicating the node
+    virtual json_node_type node_type() const override {
+        if(m_error != 0) {
+            return json_node_type::error;
+        }
+        return (json_node_type)m_state;
+    }
+    /// @brief The typed value under the cursor, if any
+    /// @return A json_value_type indicating the type
+    virtual json_value_type value_type() const override {
+        if(m_state == (int)json_node_type::value ||
+            m_state == (int)json_node_type::end_value_part) {
+            return m_value_type;
+        }
+        return json_value_type::none;
+    }
+    /// @brief Indicates the error if any
+    /// @return A json_error indicating the error
+    virtual json_error error() const override {
+        return (json_error)m_error;
+    }
+    /// @brief Retrieves the current typed value as an integer
+    /// @return The integer value
+    virtual long long value_int() const override {
+        json_value_type vt = value_type();
+        if(vt == json_value_type::integer || vt == json_value_type::real || vt == json_value_type::boolean) {
+            return m_int;
+        }
+        return 0;
+    }
+    /// @brief Retrieves the current typed value as floating point
+    /// @return The real number value
+    virtual double value_real() const override {
+        json_value_type vt = value_type();
+        if(vt == json_value_type::integer || vt == json_value_type::real) {
+            return m_real;
+        }
+        if(vt == json_value_type::boolean) {
+            return m_int != 0;
+        }
+        return 0.0;
+    }
+    /// @brief Retreives the current typed value as a boolean
+    /// @return The bool value
+    virtual bool value_bool() const override {
+        json_value_type vt = value_type();
+        if(vt == json_value_type::boolean || vt == json_value_type::integer) {
+            return m_int != 0;
+        }
+        if(vt == json_value_type::real) {
+            return m_real != 0.0;
+        }
+        return false;
+    }
+    /// @brief Returns the current string value under the cursor
+    /// @details Numbers are only converted to text when this is called
+    /// @return The string value
+    virtual const char* value() const override {
+        if(m_text_pending) {
+            format_number();
+            m_text_pending = false;
+        }
+        return m_capture;
+    }
+    /// @brief Indicates whether or not the node type is a value, value_part, or end_value_part
+    /// @return True if it's a value, otherwise false
+    virtual bool is_value() const override {
+        return m_state == (int)json_node_type::value ||
+               m_state == (int)json_node_type::value_part ||
+               m_state == (int)json_node_type::end_value_part;
+    }
+    /// @brief Indicates whether or not strings are escaped and dequoted
+    /// @return True if not escaped and dequoted, otherwise false
+    virtual bool raw_strings() const override {
+        return m_raw_strings;
+    }
+    /// @brief Sets whether or not the strings are escaped and dequoted
+    /// @param value True if the strings are not escaped and dequoted, otherwise false
+    virtual void raw_strings(bool value) override {
+        m_raw_strings = value;
+    }
+    /// @brief Indicates the current nested object depth
+    /// @return The nesting depth
+    virtual unsigned int depth() const override {
+        return m_depth;
+    }
+    /// @brief Sets the stream and resets the reader
+    /// @param stream The new stream
+    virtual void set(io::stream& stream) {
+        if(stream.caps().read == 0) {
+            return;
+        }
+        m_stream = &stream;
+        m_state = (int)json_node_type::initial;
+        m_depth = 0;
+        m_error = 0;
+        m_value_type = json_value_type::none;
+        m_str_remaining = 0;
+        m_str_indefinite = false;
+        m_str_close_quote = false;
+        m_text_pending = false;
+        m_capture_size = 0;
+        m_capture[0] = 0;
+        m_level = 0;
+        m_key_next = false;
+    }
+    /// @brief Reads the next element
+    /// @return True if successful, otherwise error or no more data
+    virtual bool read() override {
+        if(m_error != 0) {
+            return false;
+        }
+        switch((json_node_type)m_state) {
+            case json_node_type::error:
+            case json_node_type::end_document:
+                return false;
+            case json_node_type::value_part: {
+                m_capture_size = 0;
+                int res = fill_string();
+                if(res < 0) {
+                    return false;
+                }
+                m_state = (int)(res ? json_node_type::end_value_part : json_node_type::value_part);
+                return true;
+            }
+            default:
+                break;
+        }
+        if(m_level > 0 && m_remaining[m_level - 1] == 0) {
+            // definite length container is done
+            pop();
+            return true;
+        }
+        return read_item();
+    }
+};
+using cbor_reader = cbor_reader_ex<1024>;
+}
+#endif // HTCW_JSON_CBOR_HPP
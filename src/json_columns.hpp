@@ -0,0 +1,451 @@
+#ifndef HTCW_JSON_COLUMNS_HPP
+#define HTCW_JSON_COLUMNS_HPP
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "json.hpp"
+#include "json_path.hpp"
+namespace json {
+/// @brief Indicates the storage type of a column
+enum struct json_column_type : uint8_t {
+    /// @brief int64_t values
+    int64 = 0,
+    /// @brief double values
+    real = 1,
+    /// @brief uint8_t values that are 0 or 1
+    boolean = 2,
+    /// @brief Offsets into a contiguous byte buffer
+    string = 3
+};
+/// @brief A typed, contiguous column of values with a validity bitmap
+/// @details Rows whose key is missing, null, or of the wrong type are null. Null rows hold 0 or an empty string.
+class json_column final {
+    template <size_t MaxColumns, size_t MaxDepth>
+    friend class json_columns_ex;
+    const char* m_name;
+    json_column_type m_type;
+    size_t m_size;
+    size_t m_capacity;
+    // int64_t, double, uint8_t or (for strings) m_capacity+1 uint32_t offsets
+    void* m_values;
+    // bit set = row has a value
+    uint8_t* m_valid;
+    char* m_bytes;
+    size_t m_bytes_size;
+    size_t m_bytes_capacity;
+    void* (*m_reallocate)(void*, size_t);
+    void (*m_deallocate)(void*);
+    json_column(const json_column& rhs) = delete;
+    json_column& operator=(const json_column& rhs) = delete;
+    size_t value_size() const {
+        switch(m_type) {
+            case json_column_type::int64:
+                return sizeof(int64_t);
+            case json_column_type::real:
+                return sizeof(double);
+            case json_column_type::boolean:
+                return sizeof(uint8_t);
+            default:
+                return sizeof(uint32_t);
+        }
+    }
+    void init(const char* name, json_column_type type, void* (*reallocate)(void*, size_t), void (*deallocate)(void*)) {
+        m_name = name;
+        m_type = type;
+        m_reallocate = reallocate;
+        m_deallocate = deallocate;
+    }
+    void release() {
+        if(m_deallocate != nullptr) {
+            if(m_values != nullptr) {
+                m_deallocate(m_values);
+            }
+            if(m_valid != nullptr) {
+                m_deallocate(m_valid);
+            }
+            if(m_bytes != nullptr) {
+                m_deallocate(m_bytes);
+            }
+        }
+        m_values = nullptr;
+        m_valid = nullptr;
+        m_bytes = nullptr;
+        m_size = 0;
+        m_capacity = 0;
+        m_bytes_size = 0;
+        m_bytes_capacity = 0;
+    }
+    bool push_null() {
+        if(m_size == m_capacity) {
+            size_t cap = m_capacity == 0 ? 64 : m_capacity * 2;
+            // strings keep one more offset than rows
+            size_t count = m_type == json_column_type::string ? cap + 1 : cap;
+            void* values = m_reallocate(m_values, count * value_size());
+            if(values == nullptr) {
+                return false;
+            }
+            m_values = values;
+            uint8_t* valid = (uint8_t*)m_reallocate(m_valid, (cap + 7) / 8);
+            if(valid == nullptr) {
+                return false;
+            }
+            m_valid = valid;
+            if(m_capacity == 0 && m_type == json_column_type::string) {
+                ((uint32_t*)m_values)[0] = 0;
+            }
+            m_capacity = cap;
+        }
+        m_valid[m_size >> 3] &= ~(uint8_t)(1 << (m_size & 7));
+        switch(m_type) {
+            case json_column_type::int64:
+                ((int64_t*)m_values)[m_size] = 0;
+                break;
+            case json_column_type::real:
+                ((double*)m_values)[m_size] = 0;
+                break;
+            case json_column_type::boolean:
+                ((uint8_t*)m_values)[m_size] = 0;
+                break;
+            default:
+                ((uint32_t*)m_values)[m_size + 1] = (uint32_t)m_bytes_size;
+                break;
+        }
+        ++m_size;
+        return true;
+    }
+    void set_valid() {
+        size_t row = m_size - 1;
+        m_valid[row >> 3] |= (uint8_t)(1 << (row & 7));
+    }
+    void begin_string() {
+        // a repeated key replaces the earlier value
+        m_bytes_size = ((uint32_t*)m_values)[m_size - 1];
+        ((uint32_t*)m_values)[m_size] = (uint32_t)m_bytes_size;
+        set_valid();
+    }
+    bool append_string(const char* sz) {
+        size_t len = strlen(sz);
+        if(m_bytes_size + len > 0xFFFFFFFFu) {
+            return false;
+        }
+        if(m_bytes_size + len > m_bytes_capacity) {
+            size_t cap = m_bytes_capacity == 0 ? 256 : m_bytes_capacity * 2;
+            while(cap < m_bytes_size + len) {
+                cap *= 2;
+            }
+            char* bytes = (char*)m_reallocate(m_bytes, cap);
+            if(bytes == nullptr) {
+                return false;
+            }
+            m_bytes = bytes;
+            m_bytes_capacity = cap;
+        }
+        memcpy(m_bytes + m_bytes_size, sz, len);
+        m_bytes_size += len;
+        ((uint32_t*)m_values)[m_size] = (uint32_t)m_bytes_size;
+        return true;
+    }
+public:
+    json_column() : m_name(nullptr), m_type(json_column_type::int64), m_size(0), m_capacity(0), m_values(nullptr), m_valid(nullptr), m_bytes(nullptr), m_bytes_size(0), m_bytes_capacity(0), m_reallocate(nullptr), m_deallocate(nullptr) {
+    }
+    ~json_column() {
+        release();
+    }
+    /// @brief Indicates the key the column was filled from
+    /// @return The key
+    const char* name() const {
+        return m_name;
+    }
+    /// @brief Indicates the storage type
+    /// @return The column type
+    json_column_type type() const {
+        return m_type;
+    }
+    /// @brief Indicates the number of rows
+    /// @return The number of rows
+    size_t size() const {
+        return m_size;
+    }
+    /// @brief Indicates whether a row has no value
+    /// @param row The row
+    /// @return True if the row is null, otherwise false
+    bool is_null(size_t row) const {
+        return row >= m_size || 0 == (m_valid[row >> 3] & (1 << (row & 7)));
+    }
+    /// @brief Counts the null rows
+    /// @return The number of null rows
+    size_t null_count() const {
+        size_t result = 0;
+        for(size_t i = 0; i < m_size; ++i) {
+            if(0 == (m_valid[i >> 3] & (1 << (i & 7)))) {
+                ++result;
+            }
+        }
+        return result;
+    }
+    /// @brief Retrieves the validity bitmap, one bit per row, least significant bit first
+    /// @return The bitmap, where a set bit indicates a value
+    const uint8_t* validity() const {
+        return m_valid;
+    }
+    /// @brief Retrieves the values of an int64 column
+    /// @return The values, or null if the column is another type
+    const int64_t* int64s() const {
+        return m_type == json_column_type::int64 ? (const int64_t*)m_values : nullptr;
+    }
+    /// @brief Retrieves the values of a real column
+    /// @return The values, or null if the column is another type
+    const double* reals() const {
+        return m_type == json_column_type::real ? (const double*)m_values : nullptr;
+    }
+    /// @brief Retrieves the values of a boolean column
+    /// @return The values, or null if the column is another type
+    const uint8_t* booleans() const {
+        return m_type == json_column_type::boolean ? (const uint8_t*)m_values : nullptr;
+    }
+    /// @brief Retrieves the offsets of a string column. Row n spans offsets[n] to offsets[n+1] in bytes().
+    /// @return The size()+1 offsets, or null if the column is another type
+    const uint32_t* offsets() const {
+        return m_type == json_column_type::string ? (const uint32_t*)m_values : nullptr;
+    }
+    /// @brief Retrieves the string data of a string column. It is not null terminated.
+    /// @return The bytes, or null if the column is another type
+    const char* bytes() const {
+        return m_type == json_column_type::string ? m_bytes : nullptr;
+    }
+    /// @brief Retrieves a string from a string column
+    /// @param row The row
+    /// @param out_length Receives the length in bytes
+    /// @return The string data, which is not null terminated, or null if not available
+    const char* string(size_t row, size_t* out_length) const {
+        if(m_type != json_column_type::string || row >= m_size) {
+            return nullptr;
+        }
+        const uint32_t* offs = (const uint32_t*)m_values;
+        if(out_length != nullptr) {
+            *out_length = offs[row + 1] - offs[row];
+        }
+        return m_bytes + offs[row];
+    }
+};
+/// @brief Transposes the objects of an array into typed columns as a reader moves through a document
+/// @tparam MaxColumns The maximum number of columns
+/// @tparam MaxDepth The maximum nesting tracked by the row path
+template <size_t MaxColumns = 16, size_t MaxDepth = 32>
+class json_columns_ex final {
+    json_path_ex<MaxDepth> m_path;
+    json_column m_columns[MaxColumns];
+    size_t m_column_count;
+    size_t m_rows;
+    void* (*m_reallocate)(void*, size_t);
+    void (*m_deallocate)(void*);
+    // container nesting within the current row, or 0 outside of a row
+    int m_row_nesting;
+    // the column receiving the current value, or -1
+    int m_current;
+    bool m_in_string;
+    bool m_failed;
+    json_columns_ex(const json_columns_ex& rhs) = delete;
+    json_columns_ex& operator=(const json_columns_ex& rhs) = delete;
+    int find_index(const char* key) const {
+        for(size_t i = 0; i < m_column_count; ++i) {
+            if(0 == strcmp(key, m_columns[i].m_name)) {
+                return (int)i;
+            }
+        }
+        return -1;
+    }
+    bool begin_row() {
+        for(size_t i = 0; i < m_column_count; ++i) {
+            if(!m_columns[i].push_null()) {
+                return false;
+            }
+        }
+        ++m_rows;
+        return true;
+    }
+    bool set_value(const json_reader_base& reader) {
+        json_column& col = m_columns[m_current];
+        json_value_type vt = reader.value_type();
+        switch(col.m_type) {
+            case json_column_type::int64:
+                if(vt == json_value_type::integer || vt == json_value_type::real) {
+                    ((int64_t*)col.m_values)[col.m_size - 1] = (int64_t)reader.value_int();
+                    col.set_valid();
+                }
+                break;
+            case json_column_type::real:
+                if(vt == json_value_type::integer || vt == json_value_type::real) {
+                    ((double*)col.m_values)[col.m_size - 1] = reader.value_real();
+                    col.set_valid();
+                }
+                break;
+            case json_column_type::boolean:
+                if(vt == json_value_type::boolean) {
+                    ((uint8_t*)col.m_values)[col.m_size - 1] = reader.value_bool();
+                    col.set_valid();
+                }
+                break;
+            default:
+                if(vt == json_value_type::none) {
+                    col.begin_string();
+                    return col.append_string(reader.value());
+                }
+                break;
+        }
+        return true;
+    }
+public:
+    /// @brief Constructs a columnar sink
+    /// @param rows_path The path of the rows, such as "seasons[].episodes[]". It must remain valid for the life of the sink.
+    /// @param reallocate The reallocation function
+    /// @param deallocate The deallocation function
+    json_columns_ex(const char* rows_path, void* (*reallocate)(void*, size_t) = ::realloc, void (*deallocate)(void*) = ::free) : m_path(rows_path), m_column_count(0), m_rows(0), m_reallocate(reallocate), m_deallocate(deallocate), m_row_nesting(0), m_current(-1), m_in_string(false), m_failed(false) {
+    }
+    /// @brief Adds a column. Columns must be added before any rows are read.
+    /// @param key The key of the row objects to fill the column from. It must remain valid for the life of the sink.
+    /// @param type The storage type
+    /// @return True if successful, otherwise false
+    bool add(const char* key, json_column_type type) {
+        if(m_rows != 0 || m_column_count == MaxColumns || key == nullptr || find_index(key) != -1) {
+            return false;
+        }
+        m_columns[m_column_count++].init(key, type, m_reallocate, m_deallocate);
+        return true;
+    }
+    /// @brief Indicates whether the row path is valid and no allocation has failed
+    /// @return True if valid, otherwise false
+    bool valid() const {
+        return m_path.valid() && !m_failed;
+    }
+    /// @brief Indicates the number of columns
+    /// @return The number of columns
+    size_t column_count() const {
+        return m_column_count;
+    }
+    /// @brief Retrieves a column
+    /// @param index The index of the column, in the order it was added
+    /// @return The column
+    const json_column& column(size_t index) const {
+        return m_columns[index];
+    }
+    /// @brief Retrieves a column by key
+    /// @param key The key
+    /// @return The column, or null if not found
+    const json_column* find(const char* key) const {
+        int i = find_index(key);
+        return i < 0 ? nullptr : m_columns + i;
+    }
+    /// @brief Indicates the number of rows
+    /// @return The number of rows
+    size_t rows() const {
+        return m_rows;
+    }
+    /// @brief Removes all rows and frees their memory. The columns remain.
+    void clear() {
+        for(size_t i = 0; i < m_column_count; ++i) {
+            m_columns[i].release();
+        }
+        m_rows = 0;
+        m_row_nesting = 0;
+        m_current = -1;
+        m_in_string = false;
+        m_failed = false;
+        m_path.reset();
+    }
+    /// @brief Consumes the node under the cursor. Call after each successful read(). Strings should be decoded.
+    /// @param reader The reader
+    /// @return True if successful, otherwise false
+    bool feed(const json_reader_base& reader) {
+        if(m_failed) {
+            return false;
+        }
+        bool row = m_path.update(reader);
+        json_node_type nt = reader.node_type();
+        if(m_row_nesting == 0) {
+            if(row) {
+                if(!begin_row()) {
+                    m_failed = true;
+                    return false;
+                }
+                // only objects have keys. other rows stay null
+                if(nt == json_node_type::array || nt == json_node_type::object) {
+                    m_row_nesting = 1;
+                    m_current = -1;
+                }
+            }
+            return true;
+        }
+        bool ok = true;
+        switch(nt) {
+            case json_node_type::array:
+            case json_node_type::object:
+                if(m_row_nesting == 1) {
+                    m_current = -1;
+                }
+                ++m_row_nesting;
+                break;
+            case json_node_type::end_array:
+            case json_node_type::end_object:
+                --m_row_nesting;
+                break;
+            case json_node_type::field:
+                if(m_row_nesting == 1) {
+                    m_current = find_index(reader.value());
+                }
+                break;
+            case json_node_type::value:
+                if(m_row_nesting == 1 && m_current >= 0) {
+                    ok = set_value(reader);
+                    m_current = -1;
+                }
+                break;
+            case json_node_type::value_part:
+            case json_node_type::end_value_part:
+                if(m_row_nesting == 1 && m_current >= 0) {
+                    json_column& col = m_columns[m_current];
+                    if(col.m_type == json_column_type::string) {
+                        // a split number isn't a string, any more than a whole one is
+                        if(reader.is_string()) {
+                            if(!m_in_string) {
+                                col.begin_string();
+                                m_in_string = true;
+                            }
+                            ok = col.append_string(reader.value());
+                        }
+                    } else if(nt == json_node_type::end_value_part) {
+                        // the last part carries the typed value of the whole number
+                        ok = set_value(reader);
+                    }
+                }
+                if(nt == json_node_type::end_value_part && m_row_nesting == 1) {
+                    m_current = -1;
+                    m_in_string = false;
+                }
+                break;
+            default:
+                break;
+        }
+        if(!ok) {
+            m_failed = true;
+        }
+        return ok;
+    }
+    /// @brief Reads the rest of the document into the columns
+    /// @param reader The reader
+    /// @return True if successful, otherwise false
+    bool extract(json_reader_base& reader) {
+        bool raw = reader.raw_strings();
+        reader.raw_strings(false);
+        bool result = true;
+        while(result && reader.read()) {
+            result = feed(reader);
+        }
+        reader.raw_strings(raw);
+        return result && reader.error() == json_error::none;
+    }
+};
+using json_columns = json_columns_ex<>;
+}
+#endif // HTCW_JSON_COLUMNS_HPP
@@ -0,0 +1,262 @@
+#ifndef HTCW_JSON_FANOUT_HPP
+#define HTCW_JSON_FANOUT_HPP
+#include <stddef.h>
+#include <stdint.h>
+#include "json.hpp"
+#include "json_path.hpp"
+namespace json {
+/// @brief Indicates what a consumer wants after receiving a node
+enum struct json_consumer_action {
+    /// @brief Receive the next node
+    next = 0,
+    /// @brief Skip the value that starts at this node, or the value of this field. The last node of the value is still received, as though skip_value() had been called.
+    skip = 1,
+    /// @brief Receive nothing more from this document
+    stop = 2
+};
+/// @brief Receives the nodes of a document from a json_fanout_ex
+class json_consumer {
+public:
+    /// @brief Receives a node
+    /// @param reader The reader, positioned on the node
+    /// @return What the consumer wants next
+    virtual json_consumer_action node(const json_reader_base& reader) = 0;
+};
+/// @brief Drives one reader and hands every node to several consumers, so a document is only lexed once however many parts of it are needed
+/// @details Each consumer can skip values independently. The reader only skips a value, without lexing its contents, once no consumer is left that wants it.
+/// @tparam MaxConsumers The maximum number of consumers
+template <size_t MaxConsumers = 8>
+class json_fanout_ex final {
+    enum : uint8_t {
+        // receiving nodes
+        k_active = 0,
+        // skipping the value of a field that hasn't started yet
+        k_field,
+        // skipping a container until its end node at m_level
+        k_container,
+        // skipping the parts of a value until its end_value_part
+        k_part,
+        k_stopped
+    };
+    struct slot {
+        json_consumer* consumer;
+        size_t level;
+        uint8_t kind;
+    };
+    json_reader_base* m_reader;
+    slot m_slots[MaxConsumers];
+    size_t m_count;
+    // the number of open arrays and objects that have been seen
+    size_t m_level;
+    unsigned long long m_skips;
+    json_fanout_ex(const json_fanout_ex& rhs) = delete;
+    json_fanout_ex& operator=(const json_fanout_ex& rhs) = delete;
+    static bool is_container(json_node_type nt) {
+        return nt == json_node_type::array || nt == json_node_type::object;
+    }
+    static bool is_end(json_node_type nt) {
+        return nt == json_node_type::end_array || nt == json_node_type::end_object;
+    }
+    // decides whether a skipping consumer gets the node, and updates its state
+    bool wants(slot& s, json_node_type nt) const {
+        switch(s.kind) {
+            case k_active:
+                return true;
+            case k_field:
+                if(is_container(nt)) {
+                    s.kind = k_container;
+                    s.level = m_level;
+                    return false;
+                }
+                if(nt == json_node_type::value_part) {
+                    s.kind = k_part;
+                    return false;
+                }
+                // a scalar value is its own last node
+                s.kind = k_active;
+                return true;
+            case k_container:
+                if(is_end(nt) && m_level + 1 == s.level) {
+                    s.kind = k_active;
+                    return true;
+                }
+                return false;
+            case k_part:
+                if(nt == json_node_type::end_value_part) {
+                    s.kind = k_active;
+                    return true;
+                }
+                return false;
+            default:
+                return false;
+        }
+    }
+    // hands the node to every consumer that wants it. returns false if none are left.
+    bool dispatch() {
+        json_node_type nt = m_reader->node_type();
+        bool listening = false;
+        bool running = false;
+        for(size_t i = 0; i < m_count; ++i) {
+            slot& s = m_slots[i];
+            if(s.kind == k_stopped) {
+                continue;
+            }
+            running = true;
+            if(!wants(s, nt)) {
+                continue;
+            }
+            switch(s.consumer->node(*m_reader)) {
+                case json_consumer_action::skip:
+                    if(nt == json_node_type::field) {
+                        s.kind = k_field;
+                    } else if(is_container(nt)) {
+                        s.kind = k_container;
+                        s.level = m_level;
+                    } else if(nt == json_node_type::value_part) {
+                        s.kind = k_part;
+                    } else {
+                        // already the last node of the value
+                        listening = true;
+                    }
+                    break;
+                case json_consumer_action::stop:
+                    s.kind = k_stopped;
+                    break;
+                default:
+                    listening = true;
+                    break;
+            }
+        }
+        if(!running) {
+            return false;
+        }
+        // the reader can skip when nobody wants what comes next
+        if(!listening && (nt == json_node_type::field || is_container(nt) || nt == json_node_type::value_part)) {
+            bool counted = is_container(nt);
+            if(!m_reader->skip_value()) {
+                return false;
+            }
+            ++m_skips;
+            if(counted && is_end(m_reader->node_type())) {
+                --m_level;
+            }
+            return dispatch();
+        }
+        return true;
+    }
+public:
+    /// @brief Constructs a fanout over a reader
+    /// @param reader The reader to drive
+    json_fanout_ex(json_reader_base& reader) : m_reader(&reader), m_count(0), m_level(0), m_skips(0) {
+    }
+    /// @brief Registers a consumer
+    /// @param consumer The consumer, which must outlive the fanout
+    /// @return True if it was added, false if there's no room
+    bool add(json_consumer& consumer) {
+        if(m_count == MaxConsumers) {
+            return false;
+        }
+        slot& s = m_slots[m_count++];
+        s.consumer = &consumer;
+        s.level = 0;
+        s.kind = k_active;
+        return true;
+    }
+    /// @brief Indicates the number of consumers
+    /// @return The number of consumers
+    size_t size() const {
+        return m_count;
+    }
+    /// @brief Indicates how many values the reader skipped without lexing, because no consumer wanted them
+    /// @return The number of skips
+    unsigned long long skips() const {
+        return m_skips;
+    }
+    /// @brief Reads the next node and hands it to the consumers
+    /// @return True if there may be more, false at the end of the document, on error, or once every consumer has stopped
+    bool step() {
+        if(!m_reader->read()) {
+            return false;
+        }
+        json_node_type nt = m_reader->node_type();
+        if(is_container(nt)) {
+            ++m_level;
+        } else if(is_end(nt)) {
+            --m_level;
+        }
+        return dispatch();
+    }
+    /// @brief Reads the rest of the document, handing every node to the consumers
+    /// @return True if the document was read without error, otherwise false
+    bool run() {
+        while(step());
+        return m_reader->error() == json_error::none;
+    }
+};
+using json_fanout = json_fanout_ex<>;
+/// @brief Called for each node of a value that matches a subscription
+/// @param reader The reader, positioned on the node
+/// @param state The user defined state
+typedef void (*json_subscription_callback)(const json_reader_base& reader, void* state);
+/// @brief A consumer that receives the values at a path, and skips everything that can't contain them
+/// @tparam MaxDepth The maximum container nesting tracked by the path
+template <size_t MaxDepth = 32>
+class json_subscription_ex final : public json_consumer {
+    json_path_ex<MaxDepth> m_path;
+    json_subscription_callback m_callback;
+    void* m_state;
+    // the path level of the matching container being passed on, or 0
+    size_t m_level;
+    bool m_in_part;
+public:
+    /// @brief Constructs a subscription
+    /// @param pattern The json_path_ex pattern to match, which must outlive the subscription
+    /// @param callback The callback for each node of each matching value
+    /// @param state The user defined state passed to the callback
+    json_subscription_ex(const char* pattern, json_subscription_callback callback, void* state = nullptr) : m_path(pattern), m_callback(callback), m_state(state), m_level(0), m_in_part(false) {
+    }
+    /// @brief Indicates whether the pattern was understood
+    /// @return True if it's valid, otherwise false
+    bool valid() const {
+        return m_path.valid();
+    }
+    /// @brief Restarts matching at the beginning of a document
+    void reset() {
+        m_path.reset();
+        m_level = 0;
+        m_in_part = false;
+    }
+    virtual json_consumer_action node(const json_reader_base& reader) override {
+        json_node_type nt = reader.node_type();
+        m_path.update(reader);
+        if(m_level > 0) {
+            // inside a matching container
+            m_callback(reader, m_state);
+            if((nt == json_node_type::end_array || nt == json_node_type::end_object) && m_path.level() < m_level) {
+                m_level = 0;
+            }
+            return json_consumer_action::next;
+        }
+        if(m_in_part) {
+            m_callback(reader, m_state);
+            m_in_part = nt != json_node_type::end_value_part;
+            return json_consumer_action::next;
+        }
+        if(m_path.matched()) {
+            m_callback(reader, m_state);
+            if(nt == json_node_type::array || nt == json_node_type::object) {
+                m_level = m_path.level();
+            } else if(nt == json_node_type::value_part) {
+                m_in_part = true;
+            }
+            return json_consumer_action::next;
+        }
+        if((nt == json_node_type::array || nt == json_node_type::object) && !m_path.prefix_matched()) {
+            return json_consumer_action::skip;
+        }
+        return json_consumer_action::next;
+    }
+};
+using json_subscription = json_subscription_ex<>;
+}
+#endif // HTCW_JSON_FANOUT_HPP
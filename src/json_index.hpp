@@ -0,0 +1,266 @@
+#ifndef HTCW_JSON_INDEX_HPP
+#define HTCW_JSON_INDEX_HPP
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "json.hpp"
+namespace json {
+/// @brief Indicates what a sparse index sidecar records
+enum struct json_index_kind {
+    /// @brief Every element of the root array
+    elements = 0,
+    /// @brief Every value of a named field, at any depth
+    field_values = 1
+};
+/// @brief A resume point recorded in an index sidecar
+struct json_index_entry {
+    /// @brief The byte offset of the start of the value
+    unsigned long long offset;
+    /// @brief The reader depth() before the value
+    unsigned int depth;
+};
+namespace {
+    // sidecar layout, all little endian:
+    // "HJIX", version, kind, 2 reserved bytes, 64-bit entry count,
+    // then one 64-bit entry per value: offset in the low 48 bits
+    // and depth in the high 16
+    constexpr static const size_t json_index_header_size = 16;
+    constexpr static const size_t json_index_entry_size = 8;
+    constexpr static const uint8_t json_index_version = 1;
+    inline void json_index_store64(uint8_t* buf, uint64_t value) {
+        for(int i = 0; i < 8; ++i) {
+            buf[i] = (uint8_t)(value >> (i * 8));
+        }
+    }
+    inline uint64_t json_index_load64(const uint8_t* buf) {
+        uint64_t result = 0;
+        for(int i = 7; i >= 0; --i) {
+            result = (result << 8) | buf[i];
+        }
+        return result;
+    }
+    inline bool json_index_write_header(stream& sidecar, json_index_kind kind, uint64_t count) {
+        uint8_t buf[json_index_header_size];
+        memcpy(buf, "HJIX", 4);
+        buf[4] = json_index_version;
+        buf[5] = (uint8_t)kind;
+        buf[6] = 0;
+        buf[7] = 0;
+        json_index_store64(buf + 8, count);
+        return sidecar.write(buf, sizeof(buf)) == sizeof(buf);
+    }
+    inline bool json_index_write_entry(stream& sidecar, unsigned long long offset, unsigned int depth) {
+        if(offset > 0xFFFFFFFFFFFFull || depth > 0xFFFF) {
+            return false;
+        }
+        uint8_t buf[json_index_entry_size];
+        json_index_store64(buf, offset | (((uint64_t)depth) << 48));
+        return sidecar.write(buf, sizeof(buf)) == sizeof(buf);
+    }
+    inline bool json_index_finish(stream& sidecar, json_index_kind kind, uint64_t count) {
+        // patch the count if we can. otherwise it's derived from the size
+        if(sidecar.caps().seek) {
+            unsigned long long end = sidecar.seek(0, io::seek_origin::current);
+            sidecar.seek(0);
+            bool result = json_index_write_header(sidecar, kind, count);
+            sidecar.seek(end);
+            return result;
+        }
+        return true;
+    }
+    template <size_t CaptureSize, typename Dialect>
+    unsigned int json_index_depth_before(const json_reader_ex<CaptureSize, Dialect>& reader) {
+        // objects have already bumped the depth by the time we see them
+        return reader.node_type() == json_node_type::object ? reader.depth() - 1 : reader.depth();
+    }
+}
+/// @brief Builds a sidecar index of every element of the root array in a single pass
+/// @tparam CaptureSize The capture size of the reader
+/// @tparam Dialect The dialect of the reader
+/// @param reader A reader positioned at the start of the document
+/// @param sidecar The stream to write the index to
+/// @param out_count If not null, receives the number of entries
+/// @return True if successful, otherwise false
+template <size_t CaptureSize, typename Dialect>
+bool json_index_elements(json_reader_ex<CaptureSize, Dialect>& reader, stream& sidecar, unsigned long long* out_count = nullptr) {
+    uint64_t count = 0;
+    if(!json_index_write_header(sidecar, json_index_kind::elements, ~0ull)) {
+        return false;
+    }
+    int nesting = 0;
+    bool first_part = true;
+    while(reader.read()) {
+        json_node_type nt = reader.node_type();
+        switch(nt) {
+            case json_node_type::end_array:
+            case json_node_type::end_object:
+                --nesting;
+                continue;
+            case json_node_type::field:
+                continue;
+            case json_node_type::end_value_part:
+                first_part = true;
+                continue;
+            case json_node_type::value_part:
+                if(!first_part) {
+                    continue;
+                }
+                first_part = false;
+                break;
+            default:
+                break;
+        }
+        if(nesting == 0 && nt != json_node_type::array) {
+            // the root must be an array
+            return false;
+        }
+        if(nesting == 1) {
+            if(!json_index_write_entry(sidecar, reader.node_position(), json_index_depth_before(reader))) {
+                return false;
+            }
+            ++count;
+        }
+        if(nt == json_node_type::array || nt == json_node_type::object) {
+            ++nesting;
+        }
+    }
+    if(reader.error() != json_error::none) {
+        return false;
+    }
+    if(out_count != nullptr) {
+        *out_count = count;
+    }
+    return json_index_finish(sidecar, json_index_kind::elements, count);
+}
+/// @brief Builds a sidecar index of every value of the named field in a single pass
+/// @tparam CaptureSize The capture size of the reader
+/// @tparam Dialect The dialect of the reader
+/// @param reader A reader positioned at the start of the document
+/// @param field The name of the field, without quotes or escapes
+/// @param sidecar The stream to write the index to
+/// @param out_count If not null, receives the number of entries
+/// @return True if successful, otherwise false
+template <size_t CaptureSize, typename Dialect>
+bool json_index_field_values(json_reader_ex<CaptureSize, Dialect>& reader, const char* field, stream& sidecar, unsigned long long* out_count = nullptr) {
+    uint64_t count = 0;
+    if(!json_index_write_header(sidecar, json_index_kind::field_values, ~0ull)) {
+        return false;
+    }
+    bool raw = reader.raw_strings();
+    reader.raw_strings(false);
+    bool result = true;
+    bool matched = false;
+    while(result && reader.read()) {
+        if(reader.node_type() == json_node_type::field) {
+            matched = 0 == strcmp(field, reader.value());
+            continue;
+        }
+        if(matched) {
+            matched = false;
+            result = json_index_write_entry(sidecar, reader.node_position(), json_index_depth_before(reader));
+            ++count;
+        }
+    }
+    reader.raw_strings(raw);
+    if(!result || reader.error() != json_error::none) {
+        return false;
+    }
+    if(out_count != nullptr) {
+        *out_count = count;
+    }
+    return json_index_finish(sidecar, json_index_kind::field_values, count);
+}
+/// @brief Provides random access to the entries of a sidecar index
+class json_index final {
+    stream* m_sidecar;
+    json_index_kind m_kind;
+    unsigned long long m_count;
+public:
+    /// @brief Opens an index sidecar
+    /// @param sidecar A readable, seekable stream containing the index
+    json_index(stream& sidecar) : m_sidecar(nullptr), m_kind(json_index_kind::elements), m_count(0) {
+        open(sidecar);
+    }
+    json_index() : m_sidecar(nullptr), m_kind(json_index_kind::elements), m_count(0) {
+    }
+    /// @brief Opens an index sidecar
+    /// @param sidecar A readable, seekable stream containing the index
+    /// @return True if the sidecar is a valid index, otherwise false
+    bool open(stream& sidecar) {
+        m_sidecar = nullptr;
+        m_count = 0;
+        io::stream_caps caps = sidecar.caps();
+        if(!caps.read || !caps.seek) {
+            return false;
+        }
+        uint8_t buf[json_index_header_size];
+        sidecar.seek(0);
+        if(sidecar.read(buf, sizeof(buf)) != sizeof(buf) || 0 != memcmp(buf, "HJIX", 4) || buf[4] != json_index_version) {
+            return false;
+        }
+        m_kind = (json_index_kind)buf[5];
+        m_count = json_index_load64(buf + 8);
+        if(m_count == ~0ull) {
+            // the count was never patched so work it out from the size
+            unsigned long long size = sidecar.seek(0, io::seek_origin::end);
+            m_count = (size - json_index_header_size) / json_index_entry_size;
+        }
+        m_sidecar = &sidecar;
+        return true;
+    }
+    /// @brief Indicates whether the index is open
+    /// @return True if open, otherwise false
+    bool valid() const {
+        return m_sidecar != nullptr;
+    }
+    /// @brief Indicates what the index records
+    /// @return The kind of index
+    json_index_kind kind() const {
+        return m_kind;
+    }
+    /// @brief Indicates the number of entries
+    /// @return The number of entries
+    unsigned long long count() const {
+        return m_count;
+    }
+    /// @brief Retrieves an entry in constant time
+    /// @param index The zero based index of the entry
+    /// @param out_entry The entry
+    /// @return True if successful, otherwise false
+    bool entry(unsigned long long index, json_index_entry* out_entry) const {
+        if(m_sidecar == nullptr || index >= m_count || out_entry == nullptr) {
+            return false;
+        }
+        uint8_t buf[json_index_entry_size];
+        m_sidecar->seek(json_index_header_size + index * json_index_entry_size);
+        if(m_sidecar->read(buf, sizeof(buf)) != sizeof(buf)) {
+            return false;
+        }
+        uint64_t value = json_index_load64(buf);
+        out_entry->offset = value & 0xFFFFFFFFFFFFull;
+        out_entry->depth = (unsigned int)(value >> 48);
+        return true;
+    }
+    /// @brief Restarts a reader at an indexed value
+    /// @details The next read() returns the value. Reading continues through its siblings and the rest of the document after it.
+    /// @tparam CaptureSize The capture size of the reader
+    /// @tparam Dialect The dialect of the reader
+    /// @param index The zero based index of the entry
+    /// @param input The seekable stream containing the indexed document
+    /// @param reader The reader to restart
+    /// @return True if successful, otherwise false
+    template <size_t CaptureSize, typename Dialect>
+    bool seek(unsigned long long index, stream& input, json_reader_ex<CaptureSize, Dialect>& reader) const {
+        json_index_entry e;
+        if(!input.caps().seek || !entry(index, &e)) {
+            return false;
+        }
+        if(input.seek((long long)e.offset) != e.offset) {
+            return false;
+        }
+        reader.set(input, e.depth, e.offset);
+        return true;
+    }
+};
+}
+#endif // HTCW_JSON_INDEX_HPP
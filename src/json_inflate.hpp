@@ -0,0 +1,658 @@
+#ifndef HTCW_JSON_INFLATE_HPP
+#define HTCW_JSON_INFLATE_HPP
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "json.hpp"
+namespace json {
+/// @brief Indicates the container around compressed data
+enum struct json_inflate_format {
+    /// @brief Detect gzip, zlib or raw deflate from the first bytes
+    automatic = 0,
+    /// @brief RFC 1952 gzip, including concatenated members
+    gzip = 1,
+    /// @brief RFC 1950 zlib
+    zlib = 2,
+    /// @brief RFC 1951 raw deflate
+    raw = 3
+};
+namespace {
+    constexpr static const uint16_t json_inflate_length_base[] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    constexpr static const uint8_t json_inflate_length_extra[] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    constexpr static const uint16_t json_inflate_dist_base[] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+    constexpr static const uint8_t json_inflate_dist_extra[] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+    constexpr static const uint8_t json_inflate_order[] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+    // the CRC-32 table, generated at compile time
+    struct json_inflate_crc_table {
+        uint32_t entries[256];
+        constexpr json_inflate_crc_table() : entries() {
+            for(uint32_t i = 0; i < 256; ++i) {
+                uint32_t crc = i;
+                for(int j = 0; j < 8; ++j) {
+                    crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+                }
+                entries[i] = crc;
+            }
+        }
+    };
+    constexpr static const json_inflate_crc_table json_inflate_crc;
+}
+/// @brief A read only stream that decompresses gzip, zlib or raw deflate data from another stream as it is read
+/// @details Memory use is fixed: the window, a small input buffer and the Huffman tables. Nothing is decompressed ahead of the reader.
+/// @tparam WindowBits The base 2 logarithm of the window size. Data compressed with a larger window than this fails with an error. 15 handles any stream.
+/// @tparam InputSize The size of the buffer for compressed input
+template <unsigned int WindowBits = 15, size_t InputSize = 256>
+class json_inflate_stream_ex final : public stream {
+    static_assert(WindowBits >= 8 && WindowBits <= 15, "WindowBits must be between 8 and 15");
+    static_assert(InputSize > 0, "InputSize must be at least 1");
+    constexpr static const size_t window_size = ((size_t)1) << WindowBits;
+    enum struct state : uint8_t {
+        header,
+        block_header,
+        stored,
+        huffman,
+        block_end,
+        trailer,
+        done,
+        error
+    };
+    // codes up to this long decode with one table lookup
+    constexpr static const int fast_bits = 9;
+    struct huffman_table {
+        uint16_t counts[16];
+        uint16_t symbols[288];
+        // symbol << 4 | length, indexed by the next fast_bits input bits, or 0 for longer codes
+        uint16_t fast[1 << fast_bits];
+    };
+    stream* m_source;
+    json_inflate_format m_format;
+    json_inflate_format m_detected;
+    state m_state;
+    bool m_final;
+    uint8_t m_input[InputSize];
+    size_t m_input_pos;
+    size_t m_input_size;
+    uint32_t m_bits;
+    int m_bit_count;
+    uint8_t m_window[window_size];
+    size_t m_window_pos;
+    unsigned long long m_total;
+    // bytes produced by the current gzip member or zlib stream. it bounds how
+    // far back a match can reach, so it doesn't wrap at 4GB like ISIZE does
+    unsigned long long m_member_size;
+    uint32_t m_check;
+    uint32_t m_stored_left;
+    uint16_t m_copy_left;
+    uint16_t m_copy_distance;
+    huffman_table m_lengths;
+    huffman_table m_distances;
+    json_inflate_stream_ex(const json_inflate_stream_ex& rhs) = delete;
+    json_inflate_stream_ex& operator=(const json_inflate_stream_ex& rhs) = delete;
+    int peek_byte() {
+        if(m_input_pos == m_input_size) {
+            m_input_pos = 0;
+            m_input_size = m_source->read(m_input, InputSize);
+            if(m_input_size == 0) {
+                return -1;
+            }
+        }
+        return m_input[m_input_pos];
+    }
+    int next_byte() {
+        int result = peek_byte();
+        if(result != -1) {
+            ++m_input_pos;
+        }
+        return result;
+    }
+    bool need(int count) {
+        while(m_bit_count < count) {
+            int b = next_byte();
+            if(b == -1) {
+                return false;
+            }
+            m_bits |= ((uint32_t)b) << m_bit_count;
+            m_bit_count += 8;
+        }
+        return true;
+    }
+    // reads count bits, or returns -1 if the input ended
+    int32_t bits(int count) {
+        if(!need(count)) {
+            return -1;
+        }
+        int32_t result = (int32_t)(m_bits & ((((uint32_t)1) << count) - 1));
+        m_bits >>= count;
+        m_bit_count -= count;
+        return result;
+    }
+    void align() {
+        m_bits >>= m_bit_count & 7;
+        m_bit_count -= m_bit_count & 7;
+    }
+    // reads a whole byte after align(), draining the bit buffer first
+    int aligned_byte() {
+        return m_bit_count > 0 ? bits(8) : next_byte();
+    }
+    bool skip_bytes(size_t count) {
+        while(count--) {
+            if(aligned_byte() == -1) {
+                return false;
+            }
+        }
+        return true;
+    }
+    bool skip_string() {
+        int b;
+        while((b = aligned_byte()) > 0)
+            ;
+        return b == 0;
+    }
+    static bool build(huffman_table& table, const uint8_t* lengths, size_t count) {
+        uint16_t offsets[16];
+        memset(table.counts, 0, sizeof(table.counts));
+        for(size_t i = 0; i < count; ++i) {
+            ++table.counts[lengths[i]];
+        }
+        if(table.counts[0] == count) {
+            // no codes. fine as long as nothing is decoded with it
+            return true;
+        }
+        int left = 1;
+        for(int len = 1; len < 16; ++len) {
+            left <<= 1;
+            left -= table.counts[len];
+            if(left < 0) {
+                // over subscribed
+                return false;
+            }
+        }
+        offsets[1] = 0;
+        for(int len = 1; len < 15; ++len) {
+            offsets[len + 1] = offsets[len] + table.counts[len];
+        }
+        for(size_t i = 0; i < count; ++i) {
+            if(lengths[i] != 0) {
+                table.symbols[offsets[lengths[i]]++] = (uint16_t)i;
+            }
+        }
+        // assign the canonical codes and fill the lookup table with the short ones,
+        // bit reversed because codes are packed starting at the most significant bit
+        uint16_t next[16];
+        uint16_t code = 0;
+        next[0] = 0;
+        for(int len = 1; len < 16; ++len) {
+            code = (code + (len == 1 ? 0 : table.counts[len - 1])) << 1;
+            next[len] = code;
+        }
+        memset(table.fast, 0, sizeof(table.fast));
+        for(size_t i = 0; i < count; ++i) {
+            int len = lengths[i];
+            if(len == 0) {
+                continue;
+            }
+            uint16_t c = next[len]++;
+            if(len > fast_bits) {
+                continue;
+            }
+            uint16_t reversed = 0;
+            for(int b = 0; b < len; ++b) {
+                reversed = (reversed << 1) | ((c >> b) & 1);
+            }
+            for(size_t j = reversed; j < (1 << fast_bits); j += ((size_t)1) << len) {
+                table.fast[j] = (uint16_t)((i << 4) | len);
+            }
+        }
+        return true;
+    }
+    int decode(const huffman_table& table) {
+        if(need(fast_bits)) {
+            uint16_t entry = table.fast[m_bits & ((1 << fast_bits) - 1)];
+            if(entry != 0) {
+                int len = entry & 0x0F;
+                m_bits >>= len;
+                m_bit_count -= len;
+                return entry >> 4;
+            }
+        }
+        // long codes, or the end of the input
+        int code = 0;
+        int first = 0;
+        int index = 0;
+        for(int len = 1; len < 16; ++len) {
+            if(m_bit_count == 0 && !need(1)) {
+                return -1;
+            }
+            code |= m_bits & 1;
+            m_bits >>= 1;
+            --m_bit_count;
+            int count = table.counts[len];
+            if(code - count < first) {
+                return table.symbols[index + (code - first)];
+            }
+            index += count;
+            first += count;
+            first <<= 1;
+            code <<= 1;
+        }
+        return -1;
+    }
+    bool build_fixed() {
+        uint8_t lengths[288];
+        memset(lengths, 8, 144);
+        memset(lengths + 144, 9, 112);
+        memset(lengths + 256, 7, 24);
+        memset(lengths + 280, 8, 8);
+        if(!build(m_lengths, lengths, 288)) {
+            return false;
+        }
+        memset(lengths, 5, 30);
+        return build(m_distances, lengths, 30);
+    }
+    bool build_dynamic() {
+        int32_t nlen = bits(5);
+        int32_t ndist = bits(5);
+        int32_t ncode = bits(4);
+        if(nlen < 0 || ndist < 0 || ncode < 0) {
+            return false;
+        }
+        nlen += 257;
+        ndist += 1;
+        ncode += 4;
+        if(nlen > 286 || ndist > 30) {
+            return false;
+        }
+        uint8_t lengths[320];
+        memset(lengths, 0, 19);
+        for(int i = 0; i < ncode; ++i) {
+            int32_t len = bits(3);
+            if(len < 0) {
+                return false;
+            }
+            lengths[json_inflate_order[i]] = (uint8_t)len;
+        }
+        // the code length codes go in the distance table temporarily
+        if(!build(m_distances, lengths, 19)) {
+            return false;
+        }
+        int i = 0;
+        while(i < nlen + ndist) {
+            int sym = decode(m_distances);
+            if(sym < 0) {
+                return false;
+            }
+            if(sym < 16) {
+                lengths[i++] = (uint8_t)sym;
+                continue;
+            }
+            uint8_t len = 0;
+            int32_t repeat;
+            if(sym == 16) {
+                if(i == 0) {
+                    return false;
+                }
+                len = lengths[i - 1];
+                repeat = bits(2);
+                repeat = repeat < 0 ? -1 : repeat + 3;
+            } else if(sym == 17) {
+                repeat = bits(3);
+                repeat = repeat < 0 ? -1 : repeat + 3;
+            } else {
+                repeat = bits(7);
+                repeat = repeat < 0 ? -1 : repeat + 11;
+            }
+            if(repeat < 0 || i + repeat > nlen + ndist) {
+                return false;
+            }
+            while(repeat--) {
+                lengths[i++] = len;
+            }
+        }
+        if(lengths[256] == 0) {
+            // no end of block code
+            return false;
+        }
+        return build(m_lengths, lengths, nlen) && build(m_distances, lengths + nlen, ndist);
+    }
+    bool read_header() {
+        json_inflate_format fmt = m_format;
+        if(fmt == json_inflate_format::automatic) {
+            int b = peek_byte();
+            if(b == -1) {
+                return false;
+            }
+            if(b == 0x1F) {
+                fmt = json_inflate_format::gzip;
+            } else if((b & 0x0F) == 8 && (b >> 4) <= 7) {
+                fmt = json_inflate_format::zlib;
+            } else {
+                fmt = json_inflate_format::raw;
+            }
+        }
+        m_detected = fmt;
+        m_member_size = 0;
+        if(fmt == json_inflate_format::gzip) {
+            m_check = 0xFFFFFFFF;
+            if(next_byte() != 0x1F || next_byte() != 0x8B || next_byte() != 8) {
+                return false;
+            }
+            int flags = next_byte();
+            if(flags < 0 || !skip_bytes(6)) {
+                return false;
+            }
+            if(0 != (flags & 4)) {
+                int lo = next_byte();
+                int hi = next_byte();
+                if(lo < 0 || hi < 0 || !skip_bytes(lo | (hi << 8))) {
+                    return false;
+                }
+            }
+            if(0 != (flags & 8) && !skip_string()) {
+                return false;
+            }
+            if(0 != (flags & 16) && !skip_string()) {
+                return false;
+            }
+            if(0 != (flags & 2) && !skip_bytes(2)) {
+                return false;
+            }
+        } else if(fmt == json_inflate_format::zlib) {
+            m_check = 1;
+            int cmf = next_byte();
+            int flg = next_byte();
+            if(cmf < 0 || flg < 0 || (cmf & 0x0F) != 8 || ((cmf << 8) | flg) % 31 != 0 || 0 != (flg & 0x20)) {
+                // preset dictionaries aren't supported
+                return false;
+            }
+            if((unsigned int)((cmf >> 4) + 8) > WindowBits) {
+                return false;
+            }
+        }
+        return true;
+    }
+    bool read_trailer() {
+        align();
+        if(m_detected == json_inflate_format::gzip) {
+            uint32_t crc = 0;
+            uint32_t size = 0;
+            for(int i = 0; i < 4; ++i) {
+                int b = aligned_byte();
+                if(b < 0) {
+                    return false;
+                }
+                crc |= ((uint32_t)b) << (i * 8);
+            }
+            for(int i = 0; i < 4; ++i) {
+                int b = aligned_byte();
+                if(b < 0) {
+                    return false;
+                }
+                size |= ((uint32_t)b) << (i * 8);
+            }
+            return crc == (m_check ^ 0xFFFFFFFF) && size == (uint32_t)m_member_size;
+        }
+        if(m_detected == json_inflate_format::zlib) {
+            uint32_t adler = 0;
+            for(int i = 0; i < 4; ++i) {
+                int b = aligned_byte();
+                if(b < 0) {
+                    return false;
+                }
+                adler = (adler << 8) | (uint32_t)b;
+            }
+            return adler == m_check;
+        }
+        return true;
+    }
+    void update_check(const uint8_t* data, size_t size) {
+        m_member_size += size;
+        if(m_detected == json_inflate_format::gzip) {
+            uint32_t crc = m_check;
+            while(size--) {
+                crc = json_inflate_crc.entries[(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+            }
+            m_check = crc;
+        } else if(m_detected == json_inflate_format::zlib) {
+            uint32_t a = m_check & 0xFFFF;
+            uint32_t b = m_check >> 16;
+            while(size > 0) {
+                // 5552 is the most that can't overflow before the modulo
+                size_t run = size < 5552 ? size : 5552;
+                size -= run;
+                while(run--) {
+                    a += *data++;
+                    b += a;
+                }
+                a %= 65521;
+                b %= 65521;
+            }
+            m_check = (b << 16) | a;
+        }
+    }
+    void fail() {
+        m_state = state::error;
+    }
+public:
+    /// @brief Constructs a decompressing stream
+    /// @param source The stream of compressed data
+    /// @param format The container format
+    json_inflate_stream_ex(stream& source, json_inflate_format format = json_inflate_format::automatic) : m_source(&source), m_format(format) {
+        reset();
+    }
+    /// @brief Restarts decompression at the source's current position
+    void reset() {
+        m_detected = m_format;
+        m_state = state::header;
+        m_final = false;
+        m_input_pos = 0;
+        m_input_size = 0;
+        m_bits = 0;
+        m_bit_count = 0;
+        m_window_pos = 0;
+        m_total = 0;
+        m_member_size = 0;
+        m_check = 0;
+        m_stored_left = 0;
+        m_copy_left = 0;
+        m_copy_distance = 0;
+    }
+    /// @brief Indicates whether the compressed data was corrupt, truncated, or needed a larger window
+    /// @return True if there was an error, otherwise false
+    bool error() const {
+        return m_state == state::error;
+    }
+    /// @brief Indicates the format of the data, once it has been detected
+    /// @return The format
+    json_inflate_format format() const {
+        return m_detected;
+    }
+    /// @brief Indicates the number of bytes decompressed so far
+    /// @return The number of bytes
+    unsigned long long total() const {
+        return m_total;
+    }
+    virtual int getch() override {
+        uint8_t result;
+        return read(&result, 1) == 1 ? result : -1;
+    }
+    virtual size_t read(uint8_t* destination, size_t size) override {
+        constexpr static const size_t mask = window_size - 1;
+        size_t out = 0;
+        // where the checksum was last brought up to date
+        size_t checked = 0;
+        while(out < size) {
+            if(m_copy_left > 0) {
+                size_t pos = m_window_pos;
+                size_t from = pos - m_copy_distance;
+                while(m_copy_left > 0 && out < size) {
+                    uint8_t b = m_window[from++ & mask];
+                    m_window[pos++ & mask] = b;
+                    destination[out++] = b;
+                    --m_copy_left;
+                }
+                m_window_pos = pos & mask;
+                continue;
+            }
+            switch(m_state) {
+                case state::header:
+                    if(!read_header()) {
+                        fail();
+                        break;
+                    }
+                    m_state = state::block_header;
+                    break;
+                case state::block_header: {
+                    int32_t header = bits(3);
+                    if(header < 0) {
+                        fail();
+                        break;
+                    }
+                    m_final = 0 != (header & 1);
+                    switch(header >> 1) {
+                        case 0: {
+                            align();
+                            int b0 = aligned_byte();
+                            int b1 = aligned_byte();
+                            int b2 = aligned_byte();
+                            int b3 = aligned_byte();
+                            if(b3 < 0 || (b0 | (b1 << 8)) != (0xFFFF & ~(b2 | (b3 << 8)))) {
+                                fail();
+                                break;
+                            }
+                            m_stored_left = (uint32_t)(b0 | (b1 << 8));
+                            m_state = state::stored;
+                            break;
+                        }
+                        case 1:
+                            if(!build_fixed()) {
+                                fail();
+                                break;
+                            }
+                            m_state = state::huffman;
+                            break;
+                        case 2:
+                            if(!build_dynamic()) {
+                                fail();
+                                break;
+                            }
+                            m_state = state::huffman;
+                            break;
+                        default:
+                            fail();
+                            break;
+                    }
+                    break;
+                }
+                case state::stored:
+                    while(m_stored_left > 0 && out < size) {
+                        int b = aligned_byte();
+                        if(b < 0) {
+                            fail();
+                            break;
+                        }
+                        m_window[m_window_pos] = (uint8_t)b;
+                        m_window_pos = (m_window_pos + 1) & mask;
+                        destination[out++] = (uint8_t)b;
+                        --m_stored_left;
+                    }
+                    if(m_state == state::stored && m_stored_left == 0) {
+                        m_state = state::block_end;
+                    }
+                    break;
+                case state::huffman:
+                    while(out < size) {
+                        int sym = decode(m_lengths);
+                        if(sym < 0) {
+                            fail();
+                            break;
+                        }
+                        if(sym < 256) {
+                            m_window[m_window_pos] = (uint8_t)sym;
+                            m_window_pos = (m_window_pos + 1) & mask;
+                            destination[out++] = (uint8_t)sym;
+                            continue;
+                        }
+                        if(sym == 256) {
+                            m_state = state::block_end;
+                            break;
+                        }
+                        sym -= 257;
+                        if(sym >= 29) {
+                            fail();
+                            break;
+                        }
+                        int32_t extra = bits(json_inflate_length_extra[sym]);
+                        int dsym = decode(m_distances);
+                        if(extra < 0 || dsym < 0 || dsym >= 30) {
+                            fail();
+                            break;
+                        }
+                        int32_t dextra = bits(json_inflate_dist_extra[dsym]);
+                        if(dextra < 0) {
+                            fail();
+                            break;
+                        }
+                        uint32_t distance = json_inflate_dist_base[dsym] + dextra;
+                        if(distance > window_size || distance > m_member_size + (out - checked)) {
+                            // reaches past the window or before the start of the data
+                            fail();
+                            break;
+                        }
+                        m_copy_left = (uint16_t)(json_inflate_length_base[sym] + extra);
+                        m_copy_distance = (uint16_t)distance;
+                        break;
+                    }
+                    break;
+                case state::block_end:
+                    m_state = m_final ? state::trailer : state::block_header;
+                    break;
+                case state::trailer:
+                    update_check(destination + checked, out - checked);
+                    m_total += out - checked;
+                    checked = out;
+                    if(!read_trailer()) {
+                        fail();
+                        break;
+                    }
+                    // another gzip member may follow
+                    if(m_detected == json_inflate_format::gzip && peek_byte() == 0x1F) {
+                        m_state = state::header;
+                        m_final = false;
+                        m_bits = 0;
+                        m_bit_count = 0;
+                    } else {
+                        m_state = state::done;
+                    }
+                    break;
+                default:
+                    break;
+            }
+            if(m_state == state::done || m_state == state::error) {
+                break;
+            }
+        }
+        update_check(destination + checked, out - checked);
+        m_total += out - checked;
+        return out;
+    }
+    virtual int putch(int) override {
+        return -1;
+    }
+    virtual size_t write(const uint8_t*, size_t) override {
+        return 0;
+    }
+    /// @brief Seeking is not supported. Returns the number of bytes decompressed so far.
+    virtual unsigned long long seek(long long, io::seek_origin = io::seek_origin::start) override {
+        return m_total;
+    }
+    virtual io::stream_caps caps() const override {
+        io::stream_caps result;
+        result.read = 1;
+        result.write = 0;
+        result.seek = 0;
+        return result;
+    }
+};
+using json_inflate_stream = json_inflate_stream_ex<>;
+}
+#endif // HTCW_JSON_INFLATE_HPP
@@ -0,0 +1,283 @@
+#ifndef HTCW_JSON_MINIFY_HPP
+#define HTCW_JSON_MINIFY_HPP
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "json.hpp"
+#include "json_validate.hpp"
+namespace json {
+namespace {
+    // returns the first quote or backslash
+    inline const uint8_t* json_scan_quote(const uint8_t* p, const uint8_t* end) {
+#ifdef HTCW_JSON_SSE2
+        const __m128i quote = _mm_set1_epi8('\"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        while(end - p >= 16) {
+            __m128i v = _mm_loadu_si128((const __m128i*)p);
+            unsigned mask = (unsigned)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)));
+            if(mask != 0) {
+                return p + json_first_bit(mask);
+            }
+            p += 16;
+        }
+#else
+        typedef uintptr_t word_t;
+        const word_t ones = ((word_t)-1) / 0xFF;
+        const word_t highs = ones * 0x80;
+        while((size_t)(end - p) >= sizeof(word_t)) {
+            word_t w;
+            memcpy(&w, p, sizeof(w));
+            word_t q = w ^ (ones * '\"');
+            word_t b = w ^ (ones * '\\');
+            if(0 != ((((q - ones) & ~q) | ((b - ones) & ~b)) & highs)) {
+                break;
+            }
+            p += sizeof(w);
+        }
+#endif
+        while(p < end && *p != '\"' && *p != '\\') {
+            ++p;
+        }
+        return p;
+    }
+    // returns the first whitespace or quote outside of a string. once validated,
+    // nothing else outside of strings is at or below a space
+    inline const uint8_t* json_scan_token(const uint8_t* p, const uint8_t* end) {
+#ifdef HTCW_JSON_SSE2
+        const __m128i quote = _mm_set1_epi8('\"');
+        const __m128i space = _mm_set1_epi8(' ');
+        while(end - p >= 16) {
+            __m128i v = _mm_loadu_si128((const __m128i*)p);
+            // unsigned v <= ' '
+            __m128i ws = _mm_cmpeq_epi8(_mm_min_epu8(v, space), v);
+            unsigned mask = (unsigned)_mm_movemask_epi8(_mm_or_si128(ws, _mm_cmpeq_epi8(v, quote)));
+            if(mask != 0) {
+                return p + json_first_bit(mask);
+            }
+            p += 16;
+        }
+#else
+        typedef uintptr_t word_t;
+        const word_t ones = ((word_t)-1) / 0xFF;
+        const word_t highs = ones * 0x80;
+        while((size_t)(end - p) >= sizeof(word_t)) {
+            word_t w;
+            memcpy(&w, p, sizeof(w));
+            word_t q = w ^ (ones * '\"');
+            if(0 != ((((q - ones) & ~q) | ((w - ones * 0x21) & ~w)) & highs)) {
+                break;
+            }
+            p += sizeof(w);
+        }
+#endif
+        while(p < end && *p > ' ' && *p != '\"') {
+            ++p;
+        }
+        return p;
+    }
+    template <size_t BufferSize>
+    class json_rewriter {
+        stream* m_output;
+        unsigned int m_indent;
+        size_t m_depth;
+        size_t m_size;
+        bool m_in_string;
+        bool m_escape;
+        // a container was just opened and has no children yet
+        bool m_open;
+        bool m_error;
+        uint8_t m_buffer[BufferSize];
+        bool flush() {
+            if(!m_error && m_size > 0 && m_output->write(m_buffer, m_size) != m_size) {
+                m_error = true;
+            }
+            m_size = 0;
+            return !m_error;
+        }
+        void put(const uint8_t* data, size_t size) {
+            if(m_size + size > BufferSize) {
+                flush();
+                if(size >= BufferSize) {
+                    if(!m_error && m_output->write(data, size) != size) {
+                        m_error = true;
+                    }
+                    return;
+                }
+            }
+            memcpy(m_buffer + m_size, data, size);
+            m_size += size;
+        }
+        void put(uint8_t ch) {
+            if(m_size == BufferSize) {
+                flush();
+            }
+            m_buffer[m_size++] = ch;
+        }
+        void newline() {
+            static const uint8_t spaces[] = "                                ";
+            put('\n');
+            size_t count = m_depth * m_indent;
+            while(count > 0) {
+                size_t run = count < sizeof(spaces) - 1 ? count : sizeof(spaces) - 1;
+                put(spaces, run);
+                count -= run;
+            }
+        }
+        // called before anything that starts a value or a field
+        void child() {
+            if(m_open) {
+                m_open = false;
+                newline();
+            }
+        }
+    public:
+        json_rewriter(stream& output, unsigned int indent) : m_output(&output), m_indent(indent), m_depth(0), m_size(0), m_in_string(false), m_escape(false), m_open(false), m_error(false) {
+        }
+        bool error() const {
+            return m_error;
+        }
+        bool finish() {
+            return flush();
+        }
+        // rewrites a chunk that has already been validated
+        void rewrite(const uint8_t* p, const uint8_t* end) {
+            while(p < end) {
+                if(m_in_string) {
+                    if(m_escape) {
+                        // the escaped character, which may be a quote
+                        put(*p++);
+                        m_escape = false;
+                        continue;
+                    }
+                    const uint8_t* q = json_scan_quote(p, end);
+                    put(p, q - p);
+                    if(q == end) {
+                        return;
+                    }
+                    put(*q);
+                    if(*q == '\\') {
+                        m_escape = true;
+                    } else {
+                        m_in_string = false;
+                    }
+                    p = q + 1;
+                    continue;
+                }
+                if(m_indent == 0) {
+                    // copy everything up to the next whitespace or string in one go
+                    const uint8_t* q = json_scan_token(p, end);
+                    put(p, q - p);
+                    if(q == end) {
+                        return;
+                    }
+                    if(*q == '\"') {
+                        put(*q);
+                        m_in_string = true;
+                        p = q + 1;
+                    } else {
+                        p = json_skip_ws(q, end);
+                    }
+                    continue;
+                }
+                uint8_t ch = *p;
+                switch(ch) {
+                    case ' ':
+                    case '\t':
+                    case '\n':
+                    case '\r':
+                        p = json_skip_ws(p, end);
+                        continue;
+                    case '{':
+                    case '[':
+                        child();
+                        put(ch);
+                        ++m_depth;
+                        m_open = true;
+                        break;
+                    case '}':
+                    case ']':
+                        --m_depth;
+                        if(m_open) {
+                            m_open = false;
+                        } else {
+                            newline();
+                        }
+                        put(ch);
+                        break;
+                    case ',':
+                        put(ch);
+                        newline();
+                        break;
+                    case ':':
+                        put(':');
+                        put(' ');
+                        break;
+                    case '\"':
+                        child();
+                        put(ch);
+                        m_in_string = true;
+                        break;
+                    default:
+                        child();
+                        put(ch);
+                        break;
+                }
+                ++p;
+            }
+        }
+    };
+}
+/// @brief Rewrites JSON from one stream to another with consistent indentation, validating it along the way
+/// @details Works on the text directly rather than on reader nodes. Strings, numbers and literals are copied byte for byte, and runs of whitespace are skipped 16 bytes at a time with SSE2 where it's available.
+/// The layout matches json_writer_ex. If the JSON is invalid, the output stops near the problem.
+/// @tparam MaxDepth The maximum combined nesting of arrays and objects
+/// @tparam BufferSize The size of the read and write buffers
+/// @param input The stream to read the document from
+/// @param output The stream to write the document to
+/// @param indent The number of spaces to indent each level, or 0 to minify
+/// @param out_error If not null, receives the first problem with the JSON, if any
+/// @param out_offset If not null, receives the byte offset of the first problem
+/// @return True if successful, false if the JSON is invalid or the output could not be written
+template <size_t MaxDepth = 256, size_t BufferSize = 512>
+bool json_reformat(stream& input, stream& output, unsigned int indent, json_error* out_error = nullptr, unsigned long long* out_offset = nullptr) {
+    json_validator_ex<MaxDepth> validator;
+    json_rewriter<BufferSize> rewriter(output, indent);
+    uint8_t buffer[BufferSize];
+    size_t read;
+    bool ok = true;
+    while(ok && 0 != (read = input.read(buffer, sizeof(buffer)))) {
+        // validate first, so only valid text is rewritten
+        ok = validator.feed(buffer, read);
+        if(ok) {
+            rewriter.rewrite(buffer, buffer + read);
+            ok = !rewriter.error();
+        }
+    }
+    if(ok) {
+        ok = validator.finish();
+    }
+    if(!rewriter.finish()) {
+        ok = false;
+    }
+    if(out_error != nullptr) {
+        *out_error = validator.error();
+    }
+    if(out_offset != nullptr) {
+        *out_offset = validator.error_offset();
+    }
+    return ok;
+}
+/// @brief Rewrites JSON from one stream to another without insignificant whitespace, validating it along the way
+/// @tparam MaxDepth The maximum combined nesting of arrays and objects
+/// @tparam BufferSize The size of the read and write buffers
+/// @param input The stream to read the document from
+/// @param output The stream to write the document to
+/// @param out_error If not null, receives the first problem with the JSON, if any
+/// @param out_offset If not null, receives the byte offset of the first problem
+/// @return True if successful, false if the JSON is invalid or the output could not be written
+template <size_t MaxDepth = 256, size_t BufferSize = 512>
+bool json_minify(stream& input, stream& output, json_error* out_error = nullptr, unsigned long long* out_offset = nullptr) {
+    return json_reformat<MaxDepth, BufferSize>(input, output, 0, out_error, out_offset);
+}
+}
+#endif // HTCW_JSON_MINIFY_HPP
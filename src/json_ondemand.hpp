@@ -0,0 +1,640 @@
+#ifndef HTCW_JSON_ONDEMAND_HPP
+#define HTCW_JSON_ONDEMAND_HPP
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "json.hpp"
+namespace json {
+namespace {
+    inline const char* json_ondemand_whitespace(const char* pos, const char* end) {
+        while(pos < end && (*pos == ' ' || *pos == '\t' || *pos == '\n' || *pos == '\r')) {
+            ++pos;
+        }
+        return pos;
+    }
+    // pos is on the opening quote. returns the position of the closing quote, or nullptr
+    inline const char* json_ondemand_string_end(const char* pos, const char* end) {
+        ++pos;
+        while(pos < end) {
+            const char* quote = (const char*)memchr(pos, '\"', end - pos);
+            if(quote == nullptr) {
+                return nullptr;
+            }
+            // an odd run of backslashes escapes the quote
+            const char* bs = quote;
+            while(bs > pos && bs[-1] == '\\') {
+                --bs;
+            }
+            if(((quote - bs) & 1) == 0) {
+                return quote;
+            }
+            pos = quote + 1;
+        }
+        return nullptr;
+    }
+    // pos is at the start of a value. returns the position just past it, or nullptr with error set.
+    // containers are matched by bracket without looking at what's inside
+    inline const char* json_ondemand_skip(const char* pos, const char* end, json_error* error) {
+        if(pos >= end) {
+            *error = json_error::unterminated_element;
+            return nullptr;
+        }
+        switch(*pos) {
+            case '\"':
+                pos = json_ondemand_string_end(pos, end);
+                if(pos == nullptr) {
+                    *error = json_error::unterminated_string;
+                    return nullptr;
+                }
+                return pos + 1;
+            case '[':
+            case '{': {
+                char open = *pos;
+                unsigned int nesting = 0;
+                while(pos < end) {
+                    switch(*pos) {
+                        case '\"':
+                            pos = json_ondemand_string_end(pos, end);
+                            if(pos == nullptr) {
+                                *error = json_error::unterminated_string;
+                                return nullptr;
+                            }
+                            break;
+                        case '[':
+                        case '{':
+                            ++nesting;
+                            break;
+                        case ']':
+                        case '}':
+                            if(--nesting == 0) {
+                                if((*pos == '}') != (open == '{')) {
+                                    *error = json_error::illegal_character;
+                                    return nullptr;
+                                }
+                                return pos + 1;
+                            }
+                            break;
+                    }
+                    ++pos;
+                }
+                *error = open == '{' ? json_error::unterminated_object : json_error::unterminated_array;
+                return nullptr;
+            }
+            case ',':
+            case ':':
+            case ']':
+            case '}':
+                *error = json_error::illegal_character;
+                return nullptr;
+            default:
+                // numbers and literals run to the next delimiter
+                while(pos < end && *pos != ',' && *pos != ']' && *pos != '}' && *pos != ' ' && *pos != '\t' && *pos != '\n' && *pos != '\r') {
+                    ++pos;
+                }
+                return pos;
+        }
+    }
+    inline int json_ondemand_hex(const char* pos) {
+        int result = 0;
+        for(int i = 0; i < 4; ++i) {
+            char ch = pos[i];
+            result <<= 4;
+            if(ch >= '0' && ch <= '9') {
+                result |= ch - '0';
+            } else if(ch >= 'a' && ch <= 'f') {
+                result |= ch - 'a' + 10;
+            } else if(ch >= 'A' && ch <= 'F') {
+                result |= ch - 'A' + 10;
+            } else {
+                return -1;
+            }
+        }
+        return result;
+    }
+    // decodes the next character of the body of a string, advancing pos.
+    // writes up to 4 bytes of UTF-8 to out and returns the count, or 0 if the string is malformed
+    inline size_t json_ondemand_char(const char*& pos, const char* end, char* out) {
+        unsigned char ch = (unsigned char)*pos;
+        if(ch < 0x20) {
+            return 0;
+        }
+        if(ch != '\\') {
+            *out = (char)ch;
+            ++pos;
+            return 1;
+        }
+        if(end - pos < 2) {
+            return 0;
+        }
+        int32_t cp;
+        switch(pos[1]) {
+            case '\"': cp = '\"'; break;
+            case '\\': cp = '\\'; break;
+            case '/': cp = '/'; break;
+            case 'b': cp = '\b'; break;
+            case 'f': cp = '\f'; break;
+            case 'n': cp = '\n'; break;
+            case 'r': cp = '\r'; break;
+            case 't': cp = '\t'; break;
+            case 'u':
+                if(end - pos < 6 || (cp = json_ondemand_hex(pos + 2)) < 0) {
+                    return 0;
+                }
+                if(cp >= 0xD800 && cp <= 0xDBFF) {
+                    int32_t low;
+                    if(end - pos < 12 || pos[6] != '\\' || pos[7] != 'u' || (low = json_ondemand_hex(pos + 8)) < 0xDC00 || low > 0xDFFF) {
+                        return 0;
+                    }
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    pos += 6;
+                } else if(cp >= 0xDC00 && cp <= 0xDFFF) {
+                    return 0;
+                }
+                pos += 4;
+                break;
+            default:
+                return 0;
+        }
+        pos += 2;
+        if(cp < 0x80) {
+            out[0] = (char)cp;
+            return 1;
+        }
+        if(cp < 0x800) {
+            out[0] = (char)(0xC0 | (cp >> 6));
+            out[1] = (char)(0x80 | (cp & 0x3F));
+            return 2;
+        }
+        if(cp < 0x10000) {
+            out[0] = (char)(0xE0 | (cp >> 12));
+            out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+            out[2] = (char)(0x80 | (cp & 0x3F));
+            return 3;
+        }
+        out[0] = (char)(0xF0 | (cp >> 18));
+        out[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+        out[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        out[3] = (char)(0x80 | (cp & 0x3F));
+        return 4;
+    }
+    // compares the string whose closing quote is at close with a decoded name
+    inline bool json_ondemand_equals(const char* pos, const char* close, const char* name) {
+        ++pos;
+        if(memchr(pos, '\\', close - pos) == nullptr) {
+            size_t len = close - pos;
+            return strncmp(pos, name, len) == 0 && name[len] == 0;
+        }
+        char buf[4];
+        while(pos < close) {
+            size_t len = json_ondemand_char(pos, close, buf);
+            if(len == 0 || strncmp(buf, name, len) != 0) {
+                return false;
+            }
+            name += len;
+        }
+        return *name == 0;
+    }
+}
+class json_ondemand_iterator;
+/// @brief A lazy handle to a value in an in-memory JSON document
+/// @details Nothing is parsed until it is asked for. Looking up a field or an element skips the values before it by matching brackets, without lexing them, so those values are not validated.
+/// A handle is a few pointers and can be copied freely. It remains valid as long as the buffer does.
+class json_ondemand_value {
+    friend class json_ondemand_iterator;
+    friend class json_ondemand_document;
+    const char* m_pos;
+    const char* m_end;
+    const char* m_key;
+    json_error m_error;
+    json_ondemand_value(const char* pos, const char* end, const char* key, json_error error) : m_pos(pos), m_end(end), m_key(key), m_error(error) {
+    }
+    static json_ondemand_value missing(json_error error = json_error::none) {
+        return json_ondemand_value(nullptr, nullptr, nullptr, error);
+    }
+    // copies a number or literal into a terminated buffer
+    bool scalar(char* buf, size_t size) const {
+        if(m_pos == nullptr) {
+            return false;
+        }
+        json_error error;
+        const char* next = json_ondemand_skip(m_pos, m_end, &error);
+        if(next == nullptr || (size_t)(next - m_pos) >= size) {
+            return false;
+        }
+        memcpy(buf, m_pos, next - m_pos);
+        buf[next - m_pos] = 0;
+        return true;
+    }
+    static bool is_number(const char* sz) {
+        if(*sz == '-') {
+            ++sz;
+        }
+        if(*sz == '0') {
+            ++sz;
+        } else if(*sz >= '1' && *sz <= '9') {
+            while(*sz >= '0' && *sz <= '9') {
+                ++sz;
+            }
+        } else {
+            return false;
+        }
+        if(*sz == '.') {
+            ++sz;
+            if(*sz < '0' || *sz > '9') {
+                return false;
+            }
+            while(*sz >= '0' && *sz <= '9') {
+                ++sz;
+            }
+        }
+        if(*sz == 'e' || *sz == 'E') {
+            ++sz;
+            if(*sz == '+' || *sz == '-') {
+                ++sz;
+            }
+            if(*sz < '0' || *sz > '9') {
+                return false;
+            }
+            while(*sz >= '0' && *sz <= '9') {
+                ++sz;
+            }
+        }
+        return *sz == 0;
+    }
+public:
+    /// @brief Constructs a handle that refers to nothing
+    json_ondemand_value() : m_pos(nullptr), m_end(nullptr), m_key(nullptr), m_error(json_error::none) {
+    }
+    /// @brief Indicates whether the handle refers to a value
+    /// @return True if the value exists, false if it is missing or an error occurred finding it
+    bool valid() const {
+        return m_pos != nullptr;
+    }
+    /// @brief Indicates the error found while locating the value, if any
+    /// @return The error, or json_error::none. A missing field or element is not an error.
+    json_error error() const {
+        return m_error;
+    }
+    /// @brief Indicates the kind of value
+    /// @return json_node_type::object, json_node_type::array, json_node_type::value, or json_node_type::error if the handle isn't valid
+    json_node_type node_type() const {
+        if(m_pos == nullptr) {
+            return json_node_type::error;
+        }
+        if(*m_pos == '{') {
+            return json_node_type::object;
+        }
+        if(*m_pos == '[') {
+            return json_node_type::array;
+        }
+        return json_node_type::value;
+    }
+    /// @brief Indicates the type of a scalar value from its first character
+    /// @return The json_value_type. Strings, arrays and objects are json_value_type::none.
+    json_value_type value_type() const {
+        if(m_pos == nullptr) {
+            return json_value_type::none;
+        }
+        switch(*m_pos) {
+            case 'n':
+                return json_value_type::null;
+            case 't':
+            case 'f':
+                return json_value_type::boolean;
+            case '-':
+            case '0':
+            case '1':
+            case '2':
+            case '3':
+            case '4':
+            case '5':
+            case '6':
+            case '7':
+            case '8':
+            case '9': {
+                json_error error;
+                const char* next = json_ondemand_skip(m_pos, m_end, &error);
+                for(const char* p = m_pos; p < next; ++p) {
+                    if(*p == '.' || *p == 'e' || *p == 'E') {
+                        return json_value_type::real;
+                    }
+                }
+                return json_value_type::integer;
+            }
+            default:
+                return json_value_type::none;
+        }
+    }
+    /// @brief Indicates whether the value is a string
+    /// @return True if it's a string, otherwise false
+    bool is_string() const {
+        return m_pos != nullptr && *m_pos == '\"';
+    }
+    /// @brief Indicates whether the value is null
+    /// @return True if it's null, otherwise false
+    bool is_null() const {
+        char buf[8];
+        return scalar(buf, sizeof(buf)) && strcmp(buf, "null") == 0;
+    }
+    /// @brief Finds a field of an object, skipping the fields before it
+    /// @param name The decoded field name
+    /// @return The value of the field, or an invalid handle if this isn't an object or the field is missing
+    json_ondemand_value operator[](const char* name) const {
+        if(m_pos == nullptr || *m_pos != '{') {
+            return missing(m_error);
+        }
+        const char* pos = json_ondemand_whitespace(m_pos + 1, m_end);
+        if(pos < m_end && *pos == '}') {
+            return missing();
+        }
+        while(true) {
+            if(pos >= m_end || *pos != '\"') {
+                return missing(pos >= m_end ? json_error::unterminated_object : json_error::illegal_character);
+            }
+            const char* key = pos;
+            const char* close = json_ondemand_string_end(pos, m_end);
+            if(close == nullptr) {
+                return missing(json_error::unterminated_string);
+            }
+            pos = json_ondemand_whitespace(close + 1, m_end);
+            if(pos >= m_end || *pos != ':') {
+                return missing(json_error::field_missing_value);
+            }
+            pos = json_ondemand_whitespace(pos + 1, m_end);
+            if(json_ondemand_equals(key, close, name)) {
+                if(pos >= m_end) {
+                    return missing(json_error::field_missing_value);
+                }
+                return json_ondemand_value(pos, m_end, key, json_error::none);
+            }
+            json_error error = json_error::none;
+            pos = json_ondemand_skip(pos, m_end, &error);
+            if(pos == nullptr) {
+                return missing(error);
+            }
+            pos = json_ondemand_whitespace(pos, m_end);
+            if(pos < m_end && *pos == ',') {
+                pos = json_ondemand_whitespace(pos + 1, m_end);
+                continue;
+            }
+            if(pos < m_end && *pos == '}') {
+                return missing();
+            }
+            return missing(pos >= m_end ? json_error::unterminated_object : json_error::illegal_character);
+        }
+    }
+    /// @brief Finds an element of an array, skipping the elements before it
+    /// @param index The index of the element
+    /// @return The element, or an invalid handle if this isn't an array or the index is out of range
+    json_ondemand_value at(size_t index) const;
+    /// @brief Retrieves the field name when the value came from an object
+    /// @param buffer The buffer to receive the decoded name
+    /// @param size The size of the buffer
+    /// @return True if successful, false if there is no name or it doesn't fit
+    bool get_key(char* buffer, size_t size) const {
+        if(m_key == nullptr) {
+            return false;
+        }
+        return json_ondemand_value(m_key, m_end, nullptr, json_error::none).get_string(buffer, size);
+    }
+    /// @brief Decodes a string value into a buffer
+    /// @param buffer The buffer to receive the decoded, terminated string
+    /// @param size The size of the buffer
+    /// @return True if successful, false if this isn't a valid string or it doesn't fit
+    bool get_string(char* buffer, size_t size) const {
+        if(m_pos == nullptr || *m_pos != '\"' || size == 0) {
+            return false;
+        }
+        const char* close = json_ondemand_string_end(m_pos, m_end);
+        if(close == nullptr) {
+            return false;
+        }
+        const char* pos = m_pos + 1;
+        size_t written = 0;
+        char buf[4];
+        while(pos < close) {
+            size_t len = json_ondemand_char(pos, close, buf);
+            if(len == 0 || written + len >= size) {
+                return false;
+            }
+            memcpy(buffer + written, buf, len);
+            written += len;
+        }
+        buffer[written] = 0;
+        return true;
+    }
+    /// @brief Retrieves the text of the value as it appears in the buffer, without copying it
+    /// @details Strings include their quotes and escapes. Arrays and objects include everything up to the closing bracket.
+    /// @param text Receives a pointer to the start of the value
+    /// @param length Receives the length of the value in bytes
+    /// @return True if successful, otherwise false
+    bool get_raw(const char** text, size_t* length) const {
+        if(m_pos == nullptr) {
+            return false;
+        }
+        json_error error;
+        const char* next = json_ondemand_skip(m_pos, m_end, &error);
+        if(next == nullptr) {
+            return false;
+        }
+        *text = m_pos;
+        *length = next - m_pos;
+        return true;
+    }
+    /// @brief Converts an integer value
+    /// @param value Receives the value
+    /// @return True if the value is an integer that fits in a long long, otherwise false
+    bool get_int(long long* value) const {
+        char buf[32];
+        if(!scalar(buf, sizeof(buf)) || !is_number(buf) || value_type() != json_value_type::integer) {
+            return false;
+        }
+        return json_number_to_int(buf, strlen(buf), value);
+    }
+    /// @brief Converts a number
+    /// @param value Receives the value
+    /// @return True if the value is a number, otherwise false
+    bool get_real(double* value) const {
+        char buf[64];
+        if(!scalar(buf, sizeof(buf)) || !is_number(buf)) {
+            return false;
+        }
+        // rounded the same way as the reader, without depending on the locale
+        *value = json_number_to_double(buf, strlen(buf));
+        return true;
+    }
+    /// @brief Converts a boolean value
+    /// @param value Receives the value
+    /// @return True if the value is true or false, otherwise false
+    bool get_bool(bool* value) const {
+        char buf[8];
+        if(!scalar(buf, sizeof(buf))) {
+            return false;
+        }
+        if(strcmp(buf, "true") == 0) {
+            *value = true;
+            return true;
+        }
+        if(strcmp(buf, "false") == 0) {
+            *value = false;
+            return true;
+        }
+        return false;
+    }
+    /// @brief Starts iterating the elements of an array, or the field values of an object
+    /// @return The iterator
+    json_ondemand_iterator begin() const;
+    /// @brief Marks the end of iteration
+    /// @return The iterator
+    json_ondemand_iterator end() const;
+};
+/// @brief A forward iterator over the elements of an array or the field values of an object
+/// @details Moving to the next item skips the current one by matching brackets. If the document is malformed the iterator yields one invalid value carrying the error, then ends.
+class json_ondemand_iterator {
+    friend class json_ondemand_value;
+    json_ondemand_value m_current;
+    bool m_object;
+    json_ondemand_iterator() : m_object(false) {
+    }
+    // pos is just past the opening bracket or a comma
+    void start(const char* pos, const char* end, bool first) {
+        pos = json_ondemand_whitespace(pos, end);
+        if(pos >= end) {
+            m_current = json_ondemand_value::missing(m_object ? json_error::unterminated_object : json_error::unterminated_array);
+            return;
+        }
+        if(first && *pos == (m_object ? '}' : ']')) {
+            m_current = json_ondemand_value::missing();
+            return;
+        }
+        if(!m_object) {
+            m_current = json_ondemand_value(pos, end, nullptr, json_error::none);
+            return;
+        }
+        if(*pos != '\"') {
+            m_current = json_ondemand_value::missing(json_error::illegal_character);
+            return;
+        }
+        const char* key = pos;
+        const char* close = json_ondemand_string_end(pos, end);
+        if(close == nullptr) {
+            m_current = json_ondemand_value::missing(json_error::unterminated_string);
+            return;
+        }
+        pos = json_ondemand_whitespace(close + 1, end);
+        if(pos >= end || *pos != ':') {
+            m_current = json_ondemand_value::missing(json_error::field_missing_value);
+            return;
+        }
+        pos = json_ondemand_whitespace(pos + 1, end);
+        if(pos >= end) {
+            m_current = json_ondemand_value::missing(json_error::field_missing_value);
+            return;
+        }
+        m_current = json_ondemand_value(pos, end, key, json_error::none);
+    }
+public:
+    /// @brief Retrieves the current item
+    /// @return The value. For objects, get_key() retrieves its field name.
+    const json_ondemand_value& operator*() const {
+        return m_current;
+    }
+    const json_ondemand_value* operator->() const {
+        return &m_current;
+    }
+    /// @brief Moves to the next item
+    /// @return This iterator
+    json_ondemand_iterator& operator++() {
+        if(m_current.m_pos == nullptr) {
+            // an error was yielded, so end
+            m_current.m_error = json_error::none;
+            return *this;
+        }
+        const char* end = m_current.m_end;
+        json_error error = json_error::none;
+        const char* pos = json_ondemand_skip(m_current.m_pos, end, &error);
+        if(pos == nullptr) {
+            m_current = json_ondemand_value::missing(error);
+            return *this;
+        }
+        pos = json_ondemand_whitespace(pos, end);
+        if(pos < end && *pos == ',') {
+            start(pos + 1, end, false);
+        } else if(pos < end && *pos == (m_object ? '}' : ']')) {
+            m_current = json_ondemand_value::missing();
+        } else {
+            m_current = json_ondemand_value::missing(pos >= end ? (m_object ? json_error::unterminated_object : json_error::unterminated_array) : json_error::illegal_character);
+        }
+        return *this;
+    }
+    bool operator==(const json_ondemand_iterator& rhs) const {
+        return m_current.m_pos == rhs.m_current.m_pos && m_current.m_error == rhs.m_current.m_error;
+    }
+    bool operator!=(const json_ondemand_iterator& rhs) const {
+        return !(*this == rhs);
+    }
+};
+inline json_ondemand_iterator json_ondemand_value::begin() const {
+    json_ondemand_iterator result;
+    if(m_pos != nullptr && (*m_pos == '[' || *m_pos == '{')) {
+        result.m_object = *m_pos == '{';
+        result.start(m_pos + 1, m_end, true);
+    }
+    return result;
+}
+inline json_ondemand_iterator json_ondemand_value::end() const {
+    return json_ondemand_iterator();
+}
+inline json_ondemand_value json_ondemand_value::at(size_t index) const {
+    if(m_pos == nullptr || *m_pos != '[') {
+        return missing(m_error);
+    }
+    json_ondemand_iterator it = begin();
+    while(index-- && it.m_current.m_pos != nullptr) {
+        ++it;
+    }
+    return it.m_current;
+}
+/// @brief An in-memory JSON document navigated on demand
+/// @details The document does not copy the buffer, which must outlive it and every value taken from it.
+class json_ondemand_document {
+    json_ondemand_value m_root;
+public:
+    /// @brief Constructs a document over a buffer
+    /// @param data The JSON text, which need not be terminated
+    /// @param size The size of the text in bytes
+    json_ondemand_document(const char* data, size_t size) {
+        const char* end = data + size;
+        const char* pos = json_ondemand_whitespace(data, end);
+        m_root = pos < end ? json_ondemand_value(pos, end, nullptr, json_error::none) : json_ondemand_value::missing(json_error::unterminated_element);
+    }
+    /// @brief Retrieves the root value
+    /// @return The root value
+    const json_ondemand_value& root() const {
+        return m_root;
+    }
+    /// @brief Finds a field of the root object
+    /// @param name The decoded field name
+    /// @return The value of the field
+    json_ondemand_value operator[](const char* name) const {
+        return m_root[name];
+    }
+    /// @brief Finds an element of the root array
+    /// @param index The index of the element
+    /// @return The element
+    json_ondemand_value at(size_t index) const {
+        return m_root.at(index);
+    }
+    /// @brief Starts iterating the root array or object
+    /// @return The iterator
+    json_ondemand_iterator begin() const {
+        return m_root.begin();
+    }
+    /// @brief Marks the end of iteration
+    /// @return The iterator
+    json_ondemand_iterator end() const {
+        return m_root.end();
+    }
+};
+}
+#endif // HTCW_JSON_ONDEMAND_HPP
@@ -0,0 +1,247 @@
+#ifndef HTCW_JSON_PATH_HPP
+#define HTCW_JSON_PATH_HPP
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "json.hpp"
+namespace json {
+/// @brief Matches the values at a path as a reader moves through a document
+/// @details Patterns are made of steps: a field name, * for any field, [] for any element, or [n] for element n.
+/// Field steps are separated by dots. Examples: "seasons[].episodes[]", "[].name", "networks[0].*". An empty pattern matches the root.
+/// Raw field names are compared inside their quotes, with escapes left as is.
+/// @tparam MaxDepth The maximum container nesting tracked. Deeper values never match.
+/// @tparam MaxSteps The maximum number of steps in a pattern
+template <size_t MaxDepth = 32, size_t MaxSteps = 16>
+class json_path_ex final {
+    enum struct step_kind : uint8_t {
+        field = 0,
+        any_field = 1,
+        index = 2,
+        any_index = 3
+    };
+    struct step {
+        step_kind kind;
+        uint16_t name_len;
+        const char* name;
+        unsigned long index;
+    };
+    struct frame {
+        // the index of the next step for children, or -1 if nothing below can match
+        int16_t state;
+        bool is_array;
+        unsigned long index;
+    };
+    step m_steps[MaxSteps];
+    int16_t m_step_count;
+    frame m_levels[MaxDepth];
+    size_t m_level_count;
+    // levels deeper than MaxDepth that aren't tracked
+    size_t m_overflow;
+    // the state assigned by the last field
+    int16_t m_pending;
+    bool m_in_part;
+    bool m_matched;
+    bool m_prefix;
+    bool compile(const char* pattern) {
+        m_step_count = 0;
+        const char* sz = pattern;
+        if(*sz == '.') {
+            ++sz;
+        }
+        while(*sz) {
+            if(m_step_count == (int16_t)MaxSteps) {
+                return false;
+            }
+            step& s = m_steps[m_step_count];
+            if(*sz == '[') {
+                ++sz;
+                if(*sz == ']') {
+                    s.kind = step_kind::any_index;
+                } else {
+                    if(*sz < '0' || *sz > '9') {
+                        return false;
+                    }
+                    s.kind = step_kind::index;
+                    s.index = 0;
+                    while(*sz >= '0' && *sz <= '9') {
+                        s.index = s.index * 10 + (*sz - '0');
+                        ++sz;
+                    }
+                    if(*sz != ']') {
+                        return false;
+                    }
+                }
+                ++sz;
+            } else {
+                const char* start = sz;
+                while(*sz && *sz != '.' && *sz != '[') {
+                    ++sz;
+                }
+                if(sz == start) {
+                    return false;
+                }
+                if(sz - start == 1 && *start == '*') {
+                    s.kind = step_kind::any_field;
+                } else {
+                    s.kind = step_kind::field;
+                    s.name = start;
+                    s.name_len = (uint16_t)(sz - start);
+                }
+            }
+            ++m_step_count;
+            if(*sz == '.') {
+                ++sz;
+                if(!*sz || *sz == '.') {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+    int16_t match_field(int16_t state, const char* name, bool raw) const {
+        if(state < 0 || state >= m_step_count) {
+            return -1;
+        }
+        const step& s = m_steps[state];
+        if(s.kind == step_kind::any_field) {
+            return state + 1;
+        }
+        if(s.kind == step_kind::field) {
+            if(raw && *name == '\"') {
+                // compare inside the quotes
+                if(0 == strncmp(name + 1, s.name, s.name_len) && name[s.name_len + 1] == '\"' && name[s.name_len + 2] == '\0') {
+                    return state + 1;
+                }
+            } else if(0 == strncmp(name, s.name, s.name_len) && name[s.name_len] == '\0') {
+                return state + 1;
+            }
+        }
+        return -1;
+    }
+    int16_t match_index(int16_t state, unsigned long index) const {
+        if(state < 0 || state >= m_step_count) {
+            return -1;
+        }
+        const step& s = m_steps[state];
+        if(s.kind == step_kind::any_index || (s.kind == step_kind::index && s.index == index)) {
+            return state + 1;
+        }
+        return -1;
+    }
+public:
+    /// @brief Constructs a matcher
+    /// @param pattern The pattern. It must remain valid for the life of the matcher.
+    json_path_ex(const char* pattern) {
+        if(!compile(pattern == nullptr ? "" : pattern)) {
+            m_step_count = -1;
+        }
+        reset();
+    }
+    /// @brief Indicates whether the pattern was understood
+    /// @return True if the pattern is valid, otherwise false
+    bool valid() const {
+        return m_step_count >= 0;
+    }
+    /// @brief Restarts matching at the beginning of a document
+    void reset() {
+        m_level_count = 0;
+        m_overflow = 0;
+        m_pending = -1;
+        m_in_part = false;
+        m_matched = false;
+        m_prefix = false;
+    }
+    /// @brief Advances the matcher. Call after each successful read().
+    /// @param reader The reader
+    /// @return True if the node under the cursor starts a value that matches, otherwise false
+    bool update(const json_reader_base& reader) {
+        m_matched = false;
+        m_prefix = false;
+        if(m_step_count < 0) {
+            return false;
+        }
+        json_node_type nt = reader.node_type();
+        switch(nt) {
+            case json_node_type::field:
+                if(m_overflow == 0 && m_level_count > 0) {
+                    m_pending = match_field(m_levels[m_level_count - 1].state, reader.value(), reader.raw_strings());
+                }
+                return false;
+            case json_node_type::end_array:
+            case json_node_type::end_object:
+                if(m_overflow > 0) {
+                    --m_overflow;
+                } else if(m_level_count > 0) {
+                    --m_level_count;
+                }
+                return false;
+            case json_node_type::end_value_part:
+                m_in_part = false;
+                return false;
+            case json_node_type::value_part:
+                if(m_in_part) {
+                    return false;
+                }
+                m_in_part = true;
+                break;
+            case json_node_type::value:
+            case json_node_type::array:
+            case json_node_type::object:
+                break;
+            default:
+                return false;
+        }
+        // the node starts a value
+        int16_t state;
+        if(m_overflow > 0) {
+            state = -1;
+        } else if(m_level_count == 0) {
+            state = 0;
+        } else {
+            frame& parent = m_levels[m_level_count - 1];
+            if(parent.is_array) {
+                state = match_index(parent.state, parent.index++);
+            } else {
+                state = m_pending;
+                m_pending = -1;
+            }
+        }
+        m_matched = state == m_step_count;
+        if(nt == json_node_type::array || nt == json_node_type::object) {
+            m_prefix = state >= 0 && state < m_step_count && m_level_count < MaxDepth;
+            if(m_overflow > 0 || m_level_count == MaxDepth) {
+                ++m_overflow;
+            } else {
+                frame& l = m_levels[m_level_count++];
+                l.state = state;
+                l.is_array = nt == json_node_type::array;
+                l.index = 0;
+            }
+        }
+        return m_matched;
+    }
+    /// @brief Indicates whether the node under the cursor starts a value that matches
+    /// @return True if it matches, otherwise false
+    bool matched() const {
+        return m_matched;
+    }
+    /// @brief Indicates whether the array or object that starts at the cursor could contain matching values
+    /// @details When it can't, the container can be skipped with skip_value(), followed by update() with the end node
+    /// @return True if it could contain matches, otherwise false
+    bool prefix_matched() const {
+        return m_prefix;
+    }
+    /// @brief Indicates whether the value of the field under the cursor will match
+    /// @return True if the next value will match, otherwise false
+    bool field_matched() const {
+        return m_step_count >= 0 && m_pending == m_step_count;
+    }
+    /// @brief Indicates the current container nesting, counting arrays and objects
+    /// @return The number of open containers
+    size_t level() const {
+        return m_level_count + m_overflow;
+    }
+};
+using json_path = json_path_ex<>;
+}
+#endif // HTCW_JSON_PATH_HPP
@@ -0,0 +1,352 @@
+#ifndef HTCW_JSON_PIPELINE_HPP
+#define HTCW_JSON_PIPELINE_HPP
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "json.hpp"
+#include "json_path.hpp"
+namespace json {
+/// @brief Called by json_map_value_ex to replace a value
+/// @param value The value as JSON text. Strings are quoted and escaped.
+/// @param type The type of the value. Strings are json_value_type::none.
+/// @param out_value The buffer to receive the replacement as JSON text
+/// @param out_size The size of the buffer
+/// @param state The user defined state
+/// @return True to replace the value, or false to leave it as is
+typedef bool (*json_map_value_callback)(const char* value, json_value_type type, char* out_value, size_t out_size, void* state);
+namespace {
+    // quotes and escapes a name into a fixed buffer
+    inline bool json_pipeline_quote(const char* name, char* out, size_t out_size) {
+        size_t i = 0;
+        if(out_size < 3) {
+            return false;
+        }
+        out[i++] = '\"';
+        while(*name) {
+            unsigned char ch = (unsigned char)*name++;
+            const char* esc = nullptr;
+            char buf[8];
+            if(ch == '\"' || ch == '\\') {
+                buf[0] = '\\';
+                buf[1] = (char)ch;
+                buf[2] = 0;
+                esc = buf;
+            } else if(ch < 0x20) {
+                snprintf(buf, sizeof(buf), "\\u%04x", ch);
+                esc = buf;
+            }
+            if(esc != nullptr) {
+                size_t len = strlen(esc);
+                if(i + len + 2 > out_size) {
+                    return false;
+                }
+                memcpy(out + i, esc, len);
+                i += len;
+            } else {
+                if(i + 3 > out_size) {
+                    return false;
+                }
+                out[i++] = (char)ch;
+            }
+        }
+        out[i++] = '\"';
+        out[i] = 0;
+        return true;
+    }
+    inline json_value_type json_pipeline_literal_type(const char* text) {
+        switch(*text) {
+            case '\"':
+                return json_value_type::none;
+            case 'n':
+                return json_value_type::null;
+            case 't':
+            case 'f':
+                return json_value_type::boolean;
+            default:
+                return strpbrk(text, ".eEIN") != nullptr ? json_value_type::real : json_value_type::integer;
+        }
+    }
+}
+/// @brief The base of a pipeline stage. A stage reads from an upstream reader and is itself a reader, so stages chain and end in a json_writer.
+/// @details Stages work on raw strings so that tokens they don't touch pass through byte for byte. A source that can't give raw strings, such as a reader with a json_strings::decoded dialect, fails on the first read with json_error::illegal_encoding. Memory use depends only on MaxDepth.
+/// @tparam MaxDepth The maximum nesting tracked by the stage's path
+template <size_t MaxDepth = 32>
+class json_stage_ex : public json_reader_base {
+    json_stage_ex(const json_stage_ex& rhs) = delete;
+    json_stage_ex& operator=(const json_stage_ex& rhs) = delete;
+protected:
+    json_reader_base* m_source;
+    json_path_ex<MaxDepth> m_path;
+    // a node produced by the stage instead of the source
+    bool m_override;
+    json_node_type m_node_type;
+    json_value_type m_value_type;
+    const char* m_value;
+    // false if the source ignored raw_strings(true)
+    bool m_raw;
+    json_stage_ex(json_reader_base& source, const char* path) : m_source(&source), m_path(path), m_override(false), m_node_type(json_node_type::initial), m_value_type(json_value_type::none), m_value(nullptr) {
+        source.raw_strings(true);
+        m_raw = source.raw_strings();
+    }
+    /// @brief Reads the next node from the source and tracks the path
+    /// @return True if successful, otherwise false
+    bool source_read() {
+        if(!m_raw || !m_path.valid() || !m_source->read()) {
+            return false;
+        }
+        m_path.update(*m_source);
+        return true;
+    }
+    /// @brief Skips the value that starts at the source's cursor
+    /// @return True if successful, otherwise false
+    bool source_skip() {
+        json_node_type nt = m_source->node_type();
+        if(nt != json_node_type::array && nt != json_node_type::object && nt != json_node_type::value_part) {
+            return true;
+        }
+        if(!m_source->skip_value()) {
+            return false;
+        }
+        // the path sees the end node, which balances the start it already saw
+        m_path.update(*m_source);
+        return true;
+    }
+    /// @brief Replaces the node under the cursor
+    /// @param node_type The node type
+    /// @param value The JSON text of the node
+    void produce(json_node_type node_type, const char* value) {
+        m_override = true;
+        m_node_type = node_type;
+        m_value = value;
+        m_value_type = node_type == json_node_type::value ? json_pipeline_literal_type(value) : json_value_type::none;
+    }
+public:
+    virtual json_node_type node_type() const override {
+        return m_override ? m_node_type : m_source->node_type();
+    }
+    virtual json_value_type value_type() const override {
+        return m_override ? m_value_type : m_source->value_type();
+    }
+    virtual json_error error() const override {
+        // decoded strings would be written out unquoted
+        return m_raw ? m_source->error() : json_error::illegal_encoding;
+    }
+    virtual long long value_int() const override {
+        if(!m_override) {
+            return m_source->value_int();
+        }
+        switch(m_value_type) {
+            case json_value_type::boolean:
+                return *m_value == 't';
+            case json_value_type::integer:
+                return strtoll(m_value, nullptr, 10);
+            default:
+                return (long long)strtod(m_value, nullptr);
+        }
+    }
+    virtual double value_real() const override {
+        if(!m_override) {
+            return m_source->value_real();
+        }
+        return m_value_type == json_value_type::boolean ? (*m_value == 't') : strtod(m_value, nullptr);
+    }
+    virtual bool value_bool() const override {
+        if(!m_override) {
+            return m_source->value_bool();
+        }
+        return m_value_type == json_value_type::boolean ? *m_value == 't' : value_real() != 0;
+    }
+    virtual const char* value() const override {
+        return m_override ? m_value : m_source->value();
+    }
+    virtual bool is_value() const override {
+        json_node_type nt = node_type();
+        return nt == json_node_type::value || nt == json_node_type::value_part || nt == json_node_type::end_value_part;
+    }
+    virtual bool is_string() const override {
+        return m_override ? json_reader_base::is_string() : m_source->is_string();
+    }
+    /// @brief Stages always report raw strings
+    /// @return True
+    virtual bool raw_strings() const override {
+        return true;
+    }
+    /// @brief Ignored. Stages always use raw strings.
+    virtual void raw_strings(bool) override {
+    }
+    virtual unsigned int depth() const override {
+        return m_source->depth();
+    }
+};
+/// @brief A pipeline stage that removes values, along with their fields, at a path
+/// @tparam MaxDepth The maximum nesting tracked
+template <size_t MaxDepth = 32>
+class json_drop_ex final : public json_stage_ex<MaxDepth> {
+    using base_type = json_stage_ex<MaxDepth>;
+public:
+    /// @brief Constructs the stage
+    /// @param source The upstream reader or stage
+    /// @param path The path of the values to drop, such as "seasons[].episodes[].crew"
+    json_drop_ex(json_reader_base& source, const char* path) : base_type(source, path) {
+    }
+    virtual bool read() override {
+        this->m_override = false;
+        while(this->source_read()) {
+            if(this->m_source->node_type() == json_node_type::field && this->m_path.field_matched()) {
+                if(!this->source_read() || !this->source_skip()) {
+                    return false;
+                }
+                continue;
+            }
+            if(this->m_path.matched()) {
+                if(!this->source_skip()) {
+                    return false;
+                }
+                continue;
+            }
+            return true;
+        }
+        return false;
+    }
+};
+/// @brief A pipeline stage that renames the fields whose values are at a path
+/// @tparam MaxDepth The maximum nesting tracked
+/// @tparam NameSize The size of the buffer for the quoted new name
+template <size_t MaxDepth = 32, size_t NameSize = 64>
+class json_rename_ex final : public json_stage_ex<MaxDepth> {
+    using base_type = json_stage_ex<MaxDepth>;
+    char m_name[NameSize];
+    bool m_valid;
+public:
+    /// @brief Constructs the stage
+    /// @param source The upstream reader or stage
+    /// @param path The path of the fields to rename, such as "seasons[].name"
+    /// @param name The new name, unquoted and unescaped
+    json_rename_ex(json_reader_base& source, const char* path, const char* name) : base_type(source, path) {
+        m_valid = json_pipeline_quote(name, m_name, sizeof(m_name));
+    }
+    virtual bool read() override {
+        this->m_override = false;
+        if(!m_valid || !this->source_read()) {
+            return false;
+        }
+        if(this->m_source->node_type() == json_node_type::field && this->m_path.field_matched()) {
+            this->produce(json_node_type::field, m_name);
+        }
+        return true;
+    }
+};
+/// @brief A pipeline stage that replaces the values at a path, including arrays and objects, with a fixed value
+/// @tparam MaxDepth The maximum nesting tracked
+template <size_t MaxDepth = 32>
+class json_redact_ex final : public json_stage_ex<MaxDepth> {
+    using base_type = json_stage_ex<MaxDepth>;
+    const char* m_replacement;
+public:
+    /// @brief Constructs the stage
+    /// @param source The upstream reader or stage
+    /// @param path The path of the values to replace, such as "created_by[].credit_id"
+    /// @param replacement The replacement as JSON text, such as "null" or "\"***\"". It must remain valid for the life of the stage.
+    json_redact_ex(json_reader_base& source, const char* path, const char* replacement = "null") : base_type(source, path), m_replacement(replacement) {
+    }
+    virtual bool read() override {
+        this->m_override = false;
+        if(!this->source_read()) {
+            return false;
+        }
+        if(this->m_path.matched()) {
+            if(!this->source_skip()) {
+                return false;
+            }
+            this->produce(json_node_type::value, m_replacement);
+        }
+        return true;
+    }
+};
+/// @brief A pipeline stage that passes the scalar values at a path through a callback
+/// @details Strings that are too long for the source's capture buffer arrive in parts and are passed through unchanged.
+/// @tparam MaxDepth The maximum nesting tracked
+/// @tparam BufferSize The size of the buffer for a replacement
+template <size_t MaxDepth = 32, size_t BufferSize = 256>
+class json_map_value_ex final : public json_stage_ex<MaxDepth> {
+    using base_type = json_stage_ex<MaxDepth>;
+    json_map_value_callback m_callback;
+    void* m_state;
+    char m_buffer[BufferSize];
+public:
+    /// @brief Constructs the stage
+    /// @param source The upstream reader or stage
+    /// @param path The path of the values to map, such as "seasons[].episodes[].vote_average"
+    /// @param callback The callback
+    /// @param state The user defined state passed to the callback
+    json_map_value_ex(json_reader_base& source, const char* path, json_map_value_callback callback, void* state = nullptr) : base_type(source, path), m_callback(callback), m_state(state) {
+    }
+    virtual bool read() override {
+        this->m_override = false;
+        if(!this->source_read()) {
+            return false;
+        }
+        if(this->m_path.matched() && this->m_source->node_type() == json_node_type::value) {
+            m_buffer[0] = 0;
+            if(m_callback(this->m_source->value(), this->m_source->value_type(), m_buffer, sizeof(m_buffer), m_state) && m_buffer[0] != 0) {
+                m_buffer[sizeof(m_buffer) - 1] = 0;
+                this->produce(json_node_type::value, m_buffer);
+            }
+        }
+        return true;
+    }
+};
+/// @brief A pipeline stage that adds a field to the start of each object at a path
+/// @tparam MaxDepth The maximum nesting tracked
+/// @tparam NameSize The size of the buffer for the quoted name
+template <size_t MaxDepth = 32, size_t NameSize = 64>
+class json_inject_field_ex final : public json_stage_ex<MaxDepth> {
+    using base_type = json_stage_ex<MaxDepth>;
+    char m_name[NameSize];
+    const char* m_value;
+    bool m_valid;
+    // 0 = pass through, 1 = field is next, 2 = value is next
+    int m_inject;
+public:
+    /// @brief Constructs the stage
+    /// @param source The upstream reader or stage
+    /// @param path The path of the objects, such as "seasons[]". An empty path is the root.
+    /// @param name The name of the field, unquoted and unescaped
+    /// @param value The value as JSON text, such as "true" or "\"tmdb\"". It must remain valid for the life of the stage.
+    json_inject_field_ex(json_reader_base& source, const char* path, const char* name, const char* value) : base_type(source, path), m_value(value), m_inject(0) {
+        m_valid = json_pipeline_quote(name, m_name, sizeof(m_name));
+    }
+    virtual bool read() override {
+        this->m_override = false;
+        if(!m_valid) {
+            return false;
+        }
+        if(m_inject == 1) {
+            m_inject = 2;
+            this->produce(json_node_type::field, m_name);
+            return true;
+        }
+        if(m_inject == 2) {
+            m_inject = 0;
+            this->produce(json_node_type::value, m_value);
+            return true;
+        }
+        if(!this->source_read()) {
+            return false;
+        }
+        if(this->m_path.matched() && this->m_source->node_type() == json_node_type::object) {
+            m_inject = 1;
+        }
+        return true;
+    }
+};
+using json_stage = json_stage_ex<>;
+using json_drop = json_drop_ex<>;
+using json_rename = json_rename_ex<>;
+using json_redact = json_redact_ex<>;
+using json_map_value = json_map_value_ex<>;
+using json_inject_field = json_inject_field_ex<>;
+}
+#endif // HTCW_JSON_PIPELINE_HPP
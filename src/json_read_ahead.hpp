@@ -0,0 +1,166 @@
+#ifndef HTCW_JSON_READ_AHEAD_HPP
+#define HTCW_JSON_READ_AHEAD_HPP
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "json.hpp"
+namespace json {
+/// @brief A read only stream that reads another stream ahead on a background thread, so the parser and the I/O overlap
+/// @details Blocks are handed from the I/O thread to the reader through a single producer, single consumer ring.
+/// A side that finds the ring full or empty polls briefly, then sleeps on a condition variable until the other side moves.
+/// Needs std::thread, so it isn't included by htcw_json.h.
+/// @tparam BlockSize The size of each block read from the source
+/// @tparam Depth The number of blocks in the ring
+template <size_t BlockSize = 4096, size_t Depth = 4>
+class json_read_ahead_stream_ex final : public stream {
+    static_assert(BlockSize > 0, "BlockSize must be at least 1");
+    static_assert(Depth > 1, "Depth must be at least 2");
+    stream* m_source;
+    uint8_t m_blocks[Depth][BlockSize];
+    size_t m_sizes[Depth];
+    // blocks published by the I/O thread
+    alignas(64) std::atomic<size_t> m_head;
+    // blocks released by the reader
+    alignas(64) std::atomic<size_t> m_tail;
+    alignas(64) std::atomic<bool> m_done;
+    std::atomic<bool> m_stop;
+    // only taken to sleep and to wake the other side
+    std::mutex m_lock;
+    std::condition_variable m_not_full;
+    std::condition_variable m_not_empty;
+    // the reader's block, and its position in it
+    uint8_t* m_current;
+    size_t m_current_size;
+    size_t m_current_pos;
+    bool m_holding;
+    unsigned long long m_position;
+    std::thread m_thread;
+    json_read_ahead_stream_ex(const json_read_ahead_stream_ex& rhs) = delete;
+    json_read_ahead_stream_ex& operator=(const json_read_ahead_stream_ex& rhs) = delete;
+    template <typename Ready>
+    void wait(std::condition_variable& condition, Ready ready) {
+        // the other side usually moves within a block's worth of work
+        for(int i = 0; i < 64; ++i) {
+            if(ready()) {
+                return;
+            }
+        }
+        std::unique_lock<std::mutex> lock(m_lock);
+        condition.wait(lock, ready);
+    }
+    void signal(std::condition_variable& condition) {
+        {
+            // a waiter checks under the lock, so taking it here means the change isn't missed
+            std::lock_guard<std::mutex> lock(m_lock);
+        }
+        condition.notify_one();
+    }
+    void produce() {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        while(true) {
+            wait(m_not_full, [this, head]() {
+                return m_stop.load(std::memory_order_relaxed) || head - m_tail.load(std::memory_order_acquire) != Depth;
+            });
+            if(m_stop.load(std::memory_order_relaxed)) {
+                break;
+            }
+            size_t i = head % Depth;
+            size_t size = m_source->read(m_blocks[i], BlockSize);
+            if(size == 0) {
+                break;
+            }
+            m_sizes[i] = size;
+            m_head.store(++head, std::memory_order_release);
+            signal(m_not_empty);
+        }
+        m_done.store(true, std::memory_order_release);
+        signal(m_not_empty);
+    }
+    // moves to the next block, waiting for it if necessary
+    bool next_block() {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if(m_holding) {
+            m_tail.store(++tail, std::memory_order_release);
+            m_holding = false;
+            signal(m_not_full);
+        }
+        wait(m_not_empty, [this, tail]() {
+            // read done before head so a final block isn't missed
+            bool done = m_done.load(std::memory_order_acquire);
+            return tail != m_head.load(std::memory_order_acquire) || done;
+        });
+        if(tail == m_head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        size_t i = tail % Depth;
+        m_current = m_blocks[i];
+        m_current_size = m_sizes[i];
+        m_current_pos = 0;
+        m_holding = true;
+        return true;
+    }
+public:
+    constexpr static const size_t block_size = BlockSize;
+    constexpr static const size_t depth = Depth;
+    /// @brief Constructs the stream and starts reading ahead
+    /// @param source The stream to read from. It is only touched by the I/O thread from here on.
+    json_read_ahead_stream_ex(stream& source) : m_source(&source), m_head(0), m_tail(0), m_done(false), m_stop(false), m_current(nullptr), m_current_size(0), m_current_pos(0), m_holding(false), m_position(0) {
+        m_thread = std::thread(&json_read_ahead_stream_ex::produce, this);
+    }
+    /// @brief Stops the I/O thread. Waits for any read of the source in progress to return.
+    virtual ~json_read_ahead_stream_ex() {
+        m_stop.store(true, std::memory_order_relaxed);
+        signal(m_not_full);
+        if(m_thread.joinable()) {
+            m_thread.join();
+        }
+    }
+    virtual int getch() override {
+        if(m_current_pos == m_current_size && !next_block()) {
+            return -1;
+        }
+        ++m_position;
+        return m_current[m_current_pos++];
+    }
+    virtual size_t read(uint8_t* destination, size_t size) override {
+        size_t result = 0;
+        while(result < size) {
+            if(m_current_pos == m_current_size && !next_block()) {
+                break;
+            }
+            size_t run = m_current_size - m_current_pos;
+            if(run > size - result) {
+                run = size - result;
+            }
+            memcpy(destination + result, m_current + m_current_pos, run);
+            m_current_pos += run;
+            result += run;
+        }
+        m_position += result;
+        return result;
+    }
+    virtual int putch(int) override {
+        return -1;
+    }
+    virtual size_t write(const uint8_t*, size_t) override {
+        return 0;
+    }
+    /// @brief Seeking is not supported. Returns the number of bytes read so far.
+    virtual unsigned long long seek(long long, io::seek_origin = io::seek_origin::start) override {
+        return m_position;
+    }
+    virtual io::stream_caps caps() const override {
+        io::stream_caps result;
+        result.read = 1;
+        result.write = 0;
+        result.seek = 0;
+        return result;
+    }
+};
+using json_read_ahead_stream = json_read_ahead_stream_ex<>;
+}
+#endif // HTCW_JSON_READ_AHEAD_HPP
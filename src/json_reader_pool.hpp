@@ -0,0 +1,139 @@
+#ifndef HTCW_JSON_READER_POOL_HPP
+#define HTCW_JSON_READER_POOL_HPP
+#include <stddef.h>
+#include <stdint.h>
+#include "json.hpp"
+namespace json {
+template <size_t CaptureSize, size_t PoolSize, typename Dialect>
+class json_reader_pool_ex;
+/// @brief A reader on loan from a pool. The reader goes back to the pool when this is destroyed.
+/// @tparam CaptureSize The capture size of the readers
+/// @tparam PoolSize The number of readers in the pool
+/// @tparam Dialect The dialect of the readers
+template <size_t CaptureSize = 1024, size_t PoolSize = 4, typename Dialect = json_dialect<>>
+class json_pooled_reader_ex final {
+    friend class json_reader_pool_ex<CaptureSize, PoolSize, Dialect>;
+    using pool_type = json_reader_pool_ex<CaptureSize, PoolSize, Dialect>;
+    using reader_type = json_reader_ex<CaptureSize, Dialect>;
+    pool_type* m_pool;
+    reader_type* m_reader;
+    json_pooled_reader_ex(pool_type* pool, reader_type* reader) : m_pool(pool), m_reader(reader) {
+    }
+    json_pooled_reader_ex(const json_pooled_reader_ex& rhs) = delete;
+    json_pooled_reader_ex& operator=(const json_pooled_reader_ex& rhs) = delete;
+public:
+    json_pooled_reader_ex() : m_pool(nullptr), m_reader(nullptr) {
+    }
+    json_pooled_reader_ex(json_pooled_reader_ex&& rhs) : m_pool(rhs.m_pool), m_reader(rhs.m_reader) {
+        rhs.m_pool = nullptr;
+        rhs.m_reader = nullptr;
+    }
+    json_pooled_reader_ex& operator=(json_pooled_reader_ex&& rhs) {
+        if(this != &rhs) {
+            release();
+            m_pool = rhs.m_pool;
+            m_reader = rhs.m_reader;
+            rhs.m_pool = nullptr;
+            rhs.m_reader = nullptr;
+        }
+        return *this;
+    }
+    ~json_pooled_reader_ex() {
+        release();
+    }
+    /// @brief Indicates whether a reader is held
+    /// @return True if a reader is held, otherwise false (the pool was exhausted)
+    bool valid() const {
+        return m_reader != nullptr;
+    }
+    /// @brief Returns the reader to the pool early
+    void release() {
+        if(m_reader != nullptr) {
+            m_pool->release(m_reader);
+            m_reader = nullptr;
+            m_pool = nullptr;
+        }
+    }
+    /// @brief Retrieves the reader
+    /// @return The reader, or null if not valid
+    reader_type* get() const {
+        return m_reader;
+    }
+    reader_type* operator->() const {
+        return m_reader;
+    }
+    reader_type& operator*() const {
+        return *m_reader;
+    }
+};
+/// @brief A fixed pool of readers that are handed out ready to use, so that readers and their capture buffers aren't constructed for each document
+/// @details The pool itself is not thread safe. Use thread_instance() to get a pool per thread.
+/// @tparam CaptureSize The capture size of the readers
+/// @tparam PoolSize The number of readers in the pool (at most 32)
+/// @tparam Dialect The dialect of the readers
+template <size_t CaptureSize = 1024, size_t PoolSize = 4, typename Dialect = json_dialect<>>
+class json_reader_pool_ex final {
+    static_assert(PoolSize > 0 && PoolSize <= 32, "PoolSize must be between 1 and 32");
+    friend class json_pooled_reader_ex<CaptureSize, PoolSize, Dialect>;
+public:
+    using reader_type = json_reader_ex<CaptureSize, Dialect>;
+    using pooled_reader_type = json_pooled_reader_ex<CaptureSize, PoolSize, Dialect>;
+    constexpr static const size_t capture_size = CaptureSize;
+    constexpr static const size_t pool_size = PoolSize;
+private:
+    reader_type m_readers[PoolSize];
+    // one bit per reader that is in use
+    uint32_t m_in_use;
+    json_reader_pool_ex(const json_reader_pool_ex& rhs) = delete;
+    json_reader_pool_ex& operator=(const json_reader_pool_ex& rhs) = delete;
+    void release(reader_type* reader) {
+        size_t i = reader - m_readers;
+        if(i < PoolSize) {
+            m_in_use &= ~(((uint32_t)1) << i);
+        }
+    }
+public:
+    json_reader_pool_ex() : m_in_use(0) {
+    }
+    /// @brief Retrieves a reset reader over the specified stream
+    /// @param input The stream to read from
+    /// @return A handle to the reader. It is not valid if every reader is in use, or if the stream can't be read.
+    pooled_reader_type acquire(stream& input) {
+        if(input.caps().read == 0) {
+            // reset() would leave the reader on its last document
+            return pooled_reader_type();
+        }
+        for(size_t i = 0; i < PoolSize; ++i) {
+            uint32_t mask = ((uint32_t)1) << i;
+            if(0 == (m_in_use & mask)) {
+                m_in_use |= mask;
+                m_readers[i].reset(input);
+                return pooled_reader_type(this, m_readers + i);
+            }
+        }
+        return pooled_reader_type();
+    }
+    /// @brief Indicates the number of readers available
+    /// @return The number of readers not in use
+    size_t available() const {
+        size_t result = 0;
+        for(size_t i = 0; i < PoolSize; ++i) {
+            if(0 == (m_in_use & (((uint32_t)1) << i))) {
+                ++result;
+            }
+        }
+        return result;
+    }
+#ifndef HTCW_JSON_NO_THREAD_LOCAL
+    /// @brief Retrieves the pool for the calling thread
+    /// @return The pool
+    static json_reader_pool_ex& thread_instance() {
+        static thread_local json_reader_pool_ex pool;
+        return pool;
+    }
+#endif
+};
+using json_reader_pool = json_reader_pool_ex<1024, 4>;
+using json_pooled_reader = json_pooled_reader_ex<1024, 4>;
+}
+#endif // HTCW_JSON_READER_POOL_HPP
@@ -0,0 +1,563 @@
+#ifndef HTCW_JSON_VALIDATE_HPP
+#define HTCW_JSON_VALIDATE_HPP
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HTCW_JSON_SSE2
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+#include "json.hpp"
+namespace json {
+namespace {
+#ifdef HTCW_JSON_SSE2
+    inline unsigned json_first_bit(unsigned mask) {
+#ifdef _MSC_VER
+        unsigned long result;
+        _BitScanForward(&result, mask);
+        return (unsigned)result;
+#else
+        return (unsigned)__builtin_ctz(mask);
+#endif
+    }
+#endif
+    // returns the first byte that ends a run of plain ASCII string data:
+    // a quote, a backslash, a control character or a non-ASCII byte
+    inline const uint8_t* json_scan_string(const uint8_t* p, const uint8_t* end) {
+#ifdef HTCW_JSON_SSE2
+        const __m128i quote = _mm_set1_epi8('\"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        const __m128i space = _mm_set1_epi8(0x20);
+        while(end - p >= 16) {
+            __m128i v = _mm_loadu_si128((const __m128i*)p);
+            // signed compare catches both control characters and bytes >= 0x80
+            __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)), _mm_cmplt_epi8(v, space));
+            unsigned mask = (unsigned)_mm_movemask_epi8(m);
+            if(mask != 0) {
+                return p + json_first_bit(mask);
+            }
+            p += 16;
+        }
+#else
+        // SWAR fallback, 4 or 8 bytes at a time depending on the word size
+        typedef uintptr_t word_t;
+        const word_t ones = ((word_t)-1) / 0xFF;
+        const word_t highs = ones * 0x80;
+        while((size_t)(end - p) >= sizeof(word_t)) {
+            word_t w;
+            memcpy(&w, p, sizeof(w));
+            word_t q = w ^ (ones * '\"');
+            word_t b = w ^ (ones * '\\');
+            word_t hit = ((q - ones) & ~q) | ((b - ones) & ~b) | (w - ones * 0x20) | w;
+            if(0 != (hit & highs)) {
+                break;
+            }
+            p += sizeof(w);
+        }
+#endif
+        while(p < end && *p != '\"' && *p != '\\' && *p >= 0x20 && *p < 0x80) {
+            ++p;
+        }
+        return p;
+    }
+    inline bool json_is_ws(uint8_t ch) {
+        return ch == ' ' || ch == '\n' || ch == '\r' || ch == '\t';
+    }
+    inline const uint8_t* json_skip_ws(const uint8_t* p, const uint8_t* end) {
+#ifdef HTCW_JSON_SSE2
+        // short runs are the norm, so only vectorize past the first byte
+        if(p < end && json_is_ws(*p)) {
+            ++p;
+            const __m128i sp = _mm_set1_epi8(' ');
+            const __m128i nl = _mm_set1_epi8('\n');
+            const __m128i cr = _mm_set1_epi8('\r');
+            const __m128i tab = _mm_set1_epi8('\t');
+            while(end - p >= 16) {
+                __m128i v = _mm_loadu_si128((const __m128i*)p);
+                __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, sp), _mm_cmpeq_epi8(v, nl)),
+                                          _mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, tab)));
+                unsigned mask = ((unsigned)_mm_movemask_epi8(ws)) ^ 0xFFFF;
+                if(mask != 0) {
+                    return p + json_first_bit(mask);
+                }
+                p += 16;
+            }
+        }
+#endif
+        while(p < end && json_is_ws(*p)) {
+            ++p;
+        }
+        return p;
+    }
+}
+/// @brief Validates JSON grammar, nesting depth and UTF-8 encoding without capturing any values
+/// @details Data may be fed in arbitrarily sized chunks
+/// @tparam MaxDepth The maximum combined nesting of arrays and objects
+template <size_t MaxDepth = 256>
+class json_validator_ex {
+public:
+    constexpr static const size_t max_depth = MaxDepth;
+private:
+    enum {
+        s_value = 0,
+        s_value_or_end_array,
+        s_key_or_end_object,
+        s_key,
+        s_colon,
+        s_after_value,
+        s_string,
+        s_string_escape,
+        s_string_hex,
+        s_string_utf8,
+        s_number_minus,
+        s_number_zero,
+        s_number_int,
+        s_number_dot,
+        s_number_frac,
+        s_number_e,
+        s_number_exp_sign,
+        s_number_exp,
+        s_literal,
+        s_error
+    };
+    uint8_t m_state;
+    bool m_in_key;
+    bool m_started;
+    uint8_t m_left;
+    uint8_t m_utf8_lo;
+    uint8_t m_utf8_hi;
+    const char* m_literal;
+    size_t m_depth;
+    uint8_t m_objects[(MaxDepth + 7) / 8];
+    unsigned long long m_offset;
+    json_error m_error;
+    unsigned long long m_error_offset;
+    bool top_is_object() const {
+        return 0 != (m_objects[(m_depth - 1) >> 3] & (1 << ((m_depth - 1) & 7)));
+    }
+    bool fail(json_error error, unsigned long long offset) {
+        m_state = s_error;
+        m_error = error;
+        m_error_offset = offset;
+        return false;
+    }
+public:
+    json_validator_ex() {
+        reset();
+    }
+    /// @brief Resets the validator to validate a new document
+    void reset() {
+        m_state = s_value;
+        m_in_key = false;
+        m_started = false;
+        m_left = 0;
+        m_utf8_lo = 0;
+        m_utf8_hi = 0;
+        m_literal = nullptr;
+        m_depth = 0;
+        m_offset = 0;
+        m_error = json_error::none;
+        m_error_offset = 0;
+    }
+    /// @brief Indicates the error if any
+    /// @return A json_error indicating the error
+    json_error error() const {
+        return m_error;
+    }
+    /// @brief Indicates the byte offset of the first problem
+    /// @return The offset from the start of the document
+    unsigned long long error_offset() const {
+        return m_error_offset;
+    }
+    /// @brief Indicates the number of bytes validated so far
+    /// @return The number of bytes
+    unsigned long long offset() const {
+        return m_offset;
+    }
+    /// @brief Validates the next chunk of the document
+    /// @param data The data
+    /// @param size The size of the data in bytes
+    /// @return True if no problems have been found so far, otherwise false
+    bool feed(const void* data, size_t size) {
+        if(m_state == s_error) {
+            return false;
+        }
+        const uint8_t* const begin = (const uint8_t*)data;
+        const uint8_t* const end = begin + size;
+        const uint8_t* p = begin;
+        uint8_t state = m_state;
+#define HTCW_JSON_FAIL(err) \
+    do { m_offset += (p - begin); return fail(json_error::err, m_offset); } while(0)
+        while(p < end) {
+            switch(state) {
+                case s_value_or_end_array:
+                    p = json_skip_ws(p, end);
+                    if(p == end) {
+                        break;
+                    }
+                    if(*p == ']') {
+                        ++p;
+                        --m_depth;
+                        state = s_after_value;
+                        break;
+                    }
+                    state = s_value;
+                    // fall through
+                case s_value:
+                    p = json_skip_ws(p, end);
+                    if(p == end) {
+                        break;
+                    }
+                    m_started = true;
+                    switch(*p) {
+                        case '{':
+                        case '[': {
+                            if(m_depth == MaxDepth) {
+                                HTCW_JSON_FAIL(nesting_too_deep);
+                            }
+                            uint8_t mask = 1 << (m_depth & 7);
+                            if(*p == '{') {
+                                m_objects[m_depth >> 3] |= mask;
+                                state = s_key_or_end_object;
+                            } else {
+                                m_objects[m_depth >> 3] &= ~mask;
+                                state = s_value_or_end_array;
+                            }
+                            ++m_depth;
+                            break;
+                        }
+                        case '\"':
+                            m_in_key = false;
+                            state = s_string;
+                            break;
+                        case '-':
+                            state = s_number_minus;
+                            break;
+                        case '0':
+                            state = s_number_zero;
+                            break;
+                        case 't':
+                            m_literal = "rue";
+                            state = s_literal;
+                            break;
+                        case 'f':
+                            m_literal = "alse";
+                            state = s_literal;
+                            break;
+                        case 'n':
+                            m_literal = "ull";
+                            state = s_literal;
+                            break;
+                        default:
+                            if(*p >= '1' && *p <= '9') {
+                                state = s_number_int;
+                                break;
+                            }
+                            HTCW_JSON_FAIL(illegal_character);
+                    }
+                    ++p;
+                    break;
+                case s_key_or_end_object:
+                    p = json_skip_ws(p, end);
+                    if(p == end) {
+                        break;
+                    }
+                    if(*p == '}') {
+                        ++p;
+                        --m_depth;
+                        state = s_after_value;
+                        break;
+                    }
+                    state = s_key;
+                    // fall through
+                case s_key:
+                    p = json_skip_ws(p, end);
+                    if(p == end) {
+                        break;
+                    }
+                    if(*p != '\"') {
+                        HTCW_JSON_FAIL(illegal_character);
+                    }
+                    ++p;
+                    m_in_key = true;
+                    state = s_string;
+                    break;
+                case s_colon:
+                    p = json_skip_ws(p, end);
+                    if(p == end) {
+                        break;
+                    }
+                    if(*p != ':') {
+                        HTCW_JSON_FAIL(field_missing_value);
+                    }
+                    ++p;
+                    state = s_value;
+                    break;
+                case s_after_value:
+                    p = json_skip_ws(p, end);
+                    if(p == end) {
+                        break;
+                    }
+                    if(m_depth == 0) {
+                        HTCW_JSON_FAIL(illegal_character);
+                    }
+                    if(*p == ',') {
+                        state = top_is_object() ? s_key : s_value;
+                    } else if(*p == ']' && !top_is_object()) {
+                        --m_depth;
+                    } else if(*p == '}' && top_is_object()) {
+                        --m_depth;
+                    } else {
+                        HTCW_JSON_FAIL(illegal_character);
+                    }
+                    ++p;
+                    break;
+                case s_string:
+                    p = json_scan_string(p, end);
+                    if(p == end) {
+                        break;
+                    }
+                    if(*p == '\"') {
+                        state = m_in_key ? s_colon : s_after_value;
+                    } else if(*p == '\\') {
+                        state = s_string_escape;
+                    } else if(*p < 0x20) {
+                        HTCW_JSON_FAIL(illegal_character);
+                    } else {
+                        // UTF-8 lead byte, per RFC 3629
+                        uint8_t ch = *p;
+                        m_utf8_lo = 0x80;
+                        m_utf8_hi = 0xBF;
+                        if(ch >= 0xC2 && ch <= 0xDF) {
+                            m_left = 1;
+                        } else if(ch >= 0xE0 && ch <= 0xEF) {
+                            m_left = 2;
+                            if(ch == 0xE0) {
+                                m_utf8_lo = 0xA0;
+                            } else if(ch == 0xED) {
+                                m_utf8_hi = 0x9F;
+                            }
+                        } else if(ch >= 0xF0 && ch <= 0xF4) {
+                            m_left = 3;
+                            if(ch == 0xF0) {
+                                m_utf8_lo = 0x90;
+                            } else if(ch == 0xF4) {
+                                m_utf8_hi = 0x8F;
+                            }
+                        } else {
+                            HTCW_JSON_FAIL(illegal_encoding);
+                        }
+                        state = s_string_utf8;
+                    }
+                    ++p;
+                    break;
+                case s_string_utf8:
+                    if(*p < m_utf8_lo || *p > m_utf8_hi) {
+                        HTCW_JSON_FAIL(illegal_encoding);
+                    }
+                    m_utf8_lo = 0x80;
+                    m_utf8_hi = 0xBF;
+                    if(0 == --m_left) {
+                        state = s_string;
+                    }
+                    ++p;
+                    break;
+                case s_string_escape:
+                    switch(*p) {
+                        case '\"':
+                        case '\\':
+                        case '/':
+                        case 'b':
+                        case 'f':
+                        case 'n':
+                        case 'r':
+                        case 't':
+                            state = s_string;
+                            break;
+                        case 'u':
+                            m_left = 4;
+                            state = s_string_hex;
+                            break;
+                        default:
+                            HTCW_JSON_FAIL(illegal_literal);
+                    }
+                    ++p;
+                    break;
+                case s_string_hex:
+                    if(!((*p >= '0' && *p <= '9') || (*p >= 'a' && *p <= 'f') || (*p >= 'A' && *p <= 'F'))) {
+                        HTCW_JSON_FAIL(illegal_literal);
+                    }
+                    if(0 == --m_left) {
+                        state = s_string;
+                    }
+                    ++p;
+                    break;
+                case s_number_minus:
+                    if(*p == '0') {
+                        state = s_number_zero;
+                    } else if(*p >= '1' && *p <= '9') {
+                        state = s_number_int;
+                    } else {
+                        HTCW_JSON_FAIL(illegal_literal);
+                    }
+                    ++p;
+                    break;
+                case s_number_zero:
+                    if(*p >= '0' && *p <= '9') {
+                        HTCW_JSON_FAIL(illegal_literal);
+                    }
+                    // fall through
+                case s_number_int:
+                    while(p < end && *p >= '0' && *p <= '9') {
+                        ++p;
+                    }
+                    if(p == end) {
+                        break;
+                    }
+                    if(*p == '.') {
+                        state = s_number_dot;
+                        ++p;
+                    } else if(*p == 'e' || *p == 'E') {
+                        state = s_number_e;
+                        ++p;
+                    } else {
+                        state = s_after_value;
+                    }
+                    break;
+                case s_number_dot:
+                    if(*p < '0' || *p > '9') {
+                        HTCW_JSON_FAIL(illegal_literal);
+                    }
+                    state = s_number_frac;
+                    ++p;
+                    break;
+                case s_number_frac:
+                    while(p < end && *p >= '0' && *p <= '9') {
+                        ++p;
+                    }
+                    if(p == end) {
+                        break;
+                    }
+                    if(*p == 'e' || *p == 'E') {
+                        state = s_number_e;
+                        ++p;
+                    } else {
+                        state = s_after_value;
+                    }
+                    break;
+                case s_number_e:
+                    if(*p == '+' || *p == '-') {
+                        state = s_number_exp_sign;
+                    } else if(*p >= '0' && *p <= '9') {
+                        state = s_number_exp;
+                    } else {
+                        HTCW_JSON_FAIL(illegal_literal);
+                    }
+                    ++p;
+                    break;
+                case s_number_exp_sign:
+                    if(*p < '0' || *p > '9') {
+                        HTCW_JSON_FAIL(illegal_literal);
+                    }
+                    state = s_number_exp;
+                    ++p;
+                    break;
+                case s_number_exp:
+                    while(p < end && *p >= '0' && *p <= '9') {
+                        ++p;
+                    }
+                    if(p < end) {
+                        state = s_after_value;
+                    }
+                    break;
+                case s_literal:
+                    if(*p != (uint8_t)*m_literal) {
+                        HTCW_JSON_FAIL(illegal_literal);
+                    }
+                    ++p;
+                    if(0 == *++m_literal) {
+                        state = s_after_value;
+                    }
+                    break;
+            }
+        }
+#undef HTCW_JSON_FAIL
+        m_state = state;
+        m_offset += size;
+        return true;
+    }
+    /// @brief Indicates the end of the document and completes validation
+    /// @return True if the document was valid, otherwise false
+    bool finish() {
+        switch(m_state) {
+            case s_error:
+                return false;
+            case s_number_zero:
+            case s_number_int:
+            case s_number_frac:
+            case s_number_exp:
+                m_state = s_after_value;
+                break;
+            case s_string:
+            case s_string_escape:
+            case s_string_hex:
+            case s_string_utf8:
+                return fail(json_error::unterminated_string, m_offset);
+            default:
+                break;
+        }
+        if(m_depth > 0) {
+            return fail(top_is_object() ? json_error::unterminated_object : json_error::unterminated_array, m_offset);
+        }
+        if(m_state != s_after_value) {
+            return fail(m_started ? json_error::illegal_literal : json_error::unterminated_element, m_offset);
+        }
+        return true;
+    }
+};
+using json_validator = json_validator_ex<256>;
+/// @brief Validates a JSON document in memory
+/// @tparam MaxDepth The maximum combined nesting of arrays and objects
+/// @param data The document
+/// @param size The size of the document in bytes
+/// @param out_offset If not null, receives the byte offset of the first problem
+/// @return json_error::none if the document is valid, otherwise the first error
+template <size_t MaxDepth = 256>
+json_error json_validate(const void* data, size_t size, unsigned long long* out_offset = nullptr) {
+    json_validator_ex<MaxDepth> validator;
+    if(validator.feed(data, size)) {
+        validator.finish();
+    }
+    if(out_offset != nullptr) {
+        *out_offset = validator.error_offset();
+    }
+    return validator.error();
+}
+/// @brief Validates a JSON document from a stream
+/// @tparam MaxDepth The maximum combined nesting of arrays and objects
+/// @tparam BufferSize The size of the read buffer
+/// @param input The stream to read the document from
+/// @param out_offset If not null, receives the byte offset of the first problem
+/// @return json_error::none if the document is valid, otherwise the first error
+template <size_t MaxDepth = 256, size_t BufferSize = 512>
+json_error json_validate(stream& input, unsigned long long* out_offset = nullptr) {
+    json_validator_ex<MaxDepth> validator;
+    uint8_t buffer[BufferSize];
+    size_t read;
+    bool ok = true;
+    while(ok && 0 != (read = input.read(buffer, sizeof(buffer)))) {
+        ok = validator.feed(buffer, read);
+    }
+    if(ok) {
+        validator.finish();
+    }
+    if(out_offset != nullptr) {
+        *out_offset = validator.error_offset();
+    }
+    return validator.error();
+}
+}
+#endif // HTCW_JSON_VALIDATE_HPP
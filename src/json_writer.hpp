@@ -0,0 +1,309 @@
+#ifndef HTCW_JSON_WRITER_HPP
+#define HTCW_JSON_WRITER_HPP
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "json.hpp"
+namespace json {
+/// @brief Writes JSON to a stream, either minified or indented
+/// @details The writer inserts the commas, colons and whitespace. Memory use is fixed regardless of the size of the document.
+/// @tparam MaxDepth The maximum nesting of arrays and objects
+template <size_t MaxDepth = 64>
+class json_writer_ex final {
+    stream* m_stream;
+    unsigned int m_indent;
+    size_t m_depth;
+    // one bit per level, set once the level has a child
+    uint8_t m_has_children[(MaxDepth + 7) / 8];
+    bool m_after_field;
+    bool m_in_part;
+    // whether the value being written in parts is a string
+    bool m_part_string;
+    bool m_error;
+    json_writer_ex(const json_writer_ex& rhs) = delete;
+    json_writer_ex& operator=(const json_writer_ex& rhs) = delete;
+    bool put(char ch) {
+        if(!m_error && m_stream->putch((uint8_t)ch) == -1) {
+            m_error = true;
+        }
+        return !m_error;
+    }
+    bool put(const char* data, size_t size) {
+        if(!m_error && size > 0 && m_stream->write((const uint8_t*)data, size) != size) {
+            m_error = true;
+        }
+        return !m_error;
+    }
+    bool newline() {
+        if(!put('\n')) {
+            return false;
+        }
+        size_t count = m_depth * m_indent;
+        while(count--) {
+            if(!put(' ')) {
+                return false;
+            }
+        }
+        return true;
+    }
+    // writes whatever is needed before a field or a value
+    bool separator() {
+        if(m_error) {
+            return false;
+        }
+        if(m_after_field) {
+            m_after_field = false;
+            return true;
+        }
+        if(m_depth == 0) {
+            return true;
+        }
+        size_t i = m_depth - 1;
+        uint8_t mask = (uint8_t)(1 << (i & 7));
+        if(0 != (m_has_children[i >> 3] & mask)) {
+            if(!put(',')) {
+                return false;
+            }
+        } else {
+            m_has_children[i >> 3] |= mask;
+        }
+        return m_indent == 0 || newline();
+    }
+    bool open(char ch) {
+        if(m_depth == MaxDepth) {
+            m_error = true;
+            return false;
+        }
+        if(!separator() || !put(ch)) {
+            return false;
+        }
+        m_has_children[m_depth >> 3] &= ~(uint8_t)(1 << (m_depth & 7));
+        ++m_depth;
+        return true;
+    }
+    bool close(char ch) {
+        if(m_depth == 0 || m_after_field) {
+            m_error = true;
+            return false;
+        }
+        --m_depth;
+        if(m_indent != 0 && 0 != (m_has_children[m_depth >> 3] & (1 << (m_depth & 7)))) {
+            if(!newline()) {
+                return false;
+            }
+        }
+        return put(ch);
+    }
+    // writes the text escaped, without quotes
+    bool escape(const char* sz) {
+        const char* run = sz;
+        while(*sz) {
+            unsigned char ch = (unsigned char)*sz;
+            if(ch >= 0x20 && ch != '\"' && ch != '\\') {
+                ++sz;
+                continue;
+            }
+            if(!put(run, sz - run)) {
+                return false;
+            }
+            char buf[8];
+            switch(ch) {
+                case '\"':
+                case '\\':
+                    buf[0] = '\\';
+                    buf[1] = (char)ch;
+                    buf[2] = 0;
+                    break;
+                case '\b':
+                    memcpy(buf, "\\b", 3);
+                    break;
+                case '\f':
+                    memcpy(buf, "\\f", 3);
+                    break;
+                case '\n':
+                    memcpy(buf, "\\n", 3);
+                    break;
+                case '\r':
+                    memcpy(buf, "\\r", 3);
+                    break;
+                case '\t':
+                    memcpy(buf, "\\t", 3);
+                    break;
+                default:
+                    snprintf(buf, sizeof(buf), "\\u%04x", ch);
+                    break;
+            }
+            if(!put(buf, strlen(buf))) {
+                return false;
+            }
+            run = ++sz;
+        }
+        return put(run, sz - run);
+    }
+    bool escaped(const char* sz) {
+        return put('\"') && escape(sz) && put('\"');
+    }
+public:
+    /// @brief Constructs a writer
+    /// @param output The stream to write to
+    /// @param indent The number of spaces to indent each level, or 0 to write minified JSON
+    json_writer_ex(stream& output, unsigned int indent = 0) : m_stream(&output), m_indent(indent), m_depth(0), m_after_field(false), m_in_part(false), m_part_string(false), m_error(false) {
+    }
+    /// @brief Indicates whether a write failed or the writer was misused
+    /// @return True if there was an error, otherwise false
+    bool error() const {
+        return m_error;
+    }
+    /// @brief Indicates the number of open arrays and objects
+    /// @return The depth
+    size_t depth() const {
+        return m_depth;
+    }
+    /// @brief Writes the start of an object
+    /// @return True if successful, otherwise false
+    bool begin_object() {
+        return open('{');
+    }
+    /// @brief Writes the end of an object
+    /// @return True if successful, otherwise false
+    bool end_object() {
+        return close('}');
+    }
+    /// @brief Writes the start of an array
+    /// @return True if successful, otherwise false
+    bool begin_array() {
+        return open('[');
+    }
+    /// @brief Writes the end of an array
+    /// @return True if successful, otherwise false
+    bool end_array() {
+        return close(']');
+    }
+    /// @brief Writes a field name, quoting and escaping it
+    /// @param name The field name
+    /// @return True if successful, otherwise false
+    bool field(const char* name) {
+        if(!separator() || !escaped(name) || !put(':') || (m_indent != 0 && !put(' '))) {
+            return false;
+        }
+        m_after_field = true;
+        return true;
+    }
+    /// @brief Writes a field name that is already quoted and escaped
+    /// @param name The field name
+    /// @return True if successful, otherwise false
+    bool field_raw(const char* name) {
+        if(!separator() || !put(name, strlen(name)) || !put(':') || (m_indent != 0 && !put(' '))) {
+            return false;
+        }
+        m_after_field = true;
+        return true;
+    }
+    /// @brief Writes a string value, quoting and escaping it
+    /// @param value The value
+    /// @return True if successful, otherwise false
+    bool value_string(const char* value) {
+        return separator() && escaped(value);
+    }
+    /// @brief Writes JSON text as is, such as a number, a literal, or a string that is already quoted and escaped
+    /// @param value The text
+    /// @param more True if more text for the same value follows, otherwise false
+    /// @return True if successful, otherwise false
+    bool value_raw(const char* value, bool more = false) {
+        if(!m_in_part && !separator()) {
+            return false;
+        }
+        m_in_part = more;
+        return put(value, strlen(value));
+    }
+    /// @brief Writes an integer value
+    /// @param value The value
+    /// @return True if successful, otherwise false
+    bool value_int(long long value) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%lld", value);
+        return value_raw(buf);
+    }
+    /// @brief Writes a floating point value using the shortest text that reads back the same. NaN and infinity are written as null.
+    /// @param value The value
+    /// @return True if successful, otherwise false
+    bool value_real(double value) {
+        if(isnan(value) || isinf(value)) {
+            return value_raw("null");
+        }
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.15g", value);
+        if(strtod(buf, nullptr) != value) {
+            snprintf(buf, sizeof(buf), "%.17g", value);
+        }
+        return value_raw(buf);
+    }
+    /// @brief Writes a boolean value
+    /// @param value The value
+    /// @return True if successful, otherwise false
+    bool value_bool(bool value) {
+        return value_raw(value ? "true" : "false");
+    }
+    /// @brief Writes a null value
+    /// @return True if successful, otherwise false
+    bool value_null() {
+        return value_raw("null");
+    }
+    /// @brief Writes the node under a reader's cursor. Raw strings and numbers are copied byte for byte.
+    /// @details A string split into parts is quoted around the whole value. Numbers and literals split into parts are written as is.
+    /// @param reader The reader
+    /// @return True if successful, otherwise false
+    bool write(const json_reader_base& reader) {
+        switch(reader.node_type()) {
+            case json_node_type::object:
+                return begin_object();
+            case json_node_type::end_object:
+                return end_object();
+            case json_node_type::array:
+                return begin_array();
+            case json_node_type::end_array:
+                return end_array();
+            case json_node_type::field:
+                return reader.raw_strings() ? field_raw(reader.value()) : field(reader.value());
+            case json_node_type::value:
+                if(reader.value_type() == json_value_type::none && !reader.raw_strings()) {
+                    return value_string(reader.value());
+                }
+                return value_raw(reader.value());
+            case json_node_type::value_part:
+            case json_node_type::end_value_part:
+                if(!m_in_part) {
+                    // value_type() isn't known until the last part, but is_string() is
+                    m_part_string = reader.is_string();
+                }
+                if(m_part_string && !reader.raw_strings()) {
+                    // the quotes go around the whole value, not each fragment
+                    if(!m_in_part && (!separator() || !put('\"'))) {
+                        return false;
+                    }
+                    m_in_part = reader.node_type() == json_node_type::value_part;
+                    return escape(reader.value()) && (m_in_part || put('\"'));
+                }
+                return value_raw(reader.value(), reader.node_type() == json_node_type::value_part);
+            default:
+                return false;
+        }
+    }
+    /// @brief Reads the rest of a document and writes it
+    /// @param reader The reader
+    /// @return True if successful, otherwise false
+    bool write_all(json_reader_base& reader) {
+        while(reader.read()) {
+            if(!write(reader)) {
+                return false;
+            }
+        }
+        return reader.error() == json_error::none && !m_error;
+    }
+};
+using json_writer = json_writer_ex<>;
+}
+#endif // HTCW_JSON_WRITER_HPP
@@ -0,0 +1,36 @@
+// the reader's success path, where error locations cost nothing, and the cost
+// of working out the line and column of an error
+#include "test.hpp"
+
+namespace {
+template <typename Reader>
+bool read_all(const std::string& text) {
+    text_stream input(text);
+    Reader reader(input);
+    while(reader.read());
+    return reader.error() == json_error::none;
+}
+}
+
+int main(int argc, char** argv) {
+    std::string doc;
+    if(argc < 2 || !read_file(argv[1], doc)) {
+        fprintf(stderr, "usage: %s <json file>\n", argv[0]);
+        return 1;
+    }
+    measure("reader", doc.size(), [&] { read_all<json_reader>(doc); });
+    measure("reader, compact", doc.size(), [&] { read_all<json_reader_ex<64, json_compact_dialect>>(doc); });
+    measure("reader, raw strings", doc.size(), [&] { read_all<json_reader_ex<1024, json_dialect<json_strings::raw>>>(doc); });
+
+    // an error at the very end, so the whole document is rescanned for its line and column
+    std::string broken = doc + ",";
+    unsigned long line = 0, column = 0;
+    measure("reader, error located", broken.size(), [&] {
+        text_stream input(broken);
+        json_reader reader(input);
+        while(reader.read());
+        reader.error_location(broken.data(), broken.size(), &line, &column);
+    });
+    printf("error at line %lu, column %lu\n", line, column);
+    return 0;
+}
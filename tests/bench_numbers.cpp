@@ -0,0 +1,37 @@
+// number conversion speed on numbers with all 17 digits, and the size of the reader state
+#include "test.hpp"
+
+namespace {
+std::string generate_reals() {
+    std::string result = "[";
+    char buffer[64];
+    for(int i = 0; i < 50000; ++i) {
+        snprintf(buffer, sizeof(buffer), "%s%.17g", i ? "," : "", (i + 1) / 3.0 * (i % 2 ? 1e-5 : 1e5));
+        result += buffer;
+    }
+    return result + "]";
+}
+
+template <typename Reader>
+double sum_reals(const std::string& text) {
+    text_stream input(text);
+    Reader reader(input);
+    double sum = 0;
+    while(reader.read()) {
+        if(reader.node_type() == json_node_type::value && reader.value_type() == json_value_type::real) {
+            sum += reader.value_real();
+        }
+    }
+    return sum;
+}
+}
+
+int main() {
+    const std::string reals = generate_reals();
+    printf("sizeof(json_reader_ex<64>): %zu\n", sizeof(json_reader_ex<64>));
+    printf("sizeof(json_reader_ex<64, json_compact_dialect>): %zu\n", sizeof(json_reader_ex<64, json_compact_dialect>));
+    double sum = 0;
+    measure("numbers", reals.size(), [&] { sum += sum_reals<json_reader>(reals); });
+    measure("numbers, compact", reals.size(), [&] { sum += sum_reals<json_reader_ex<64, json_compact_dialect>>(reals); });
+    return sum == sum ? 0 : 1;
+}
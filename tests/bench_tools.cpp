@@ -0,0 +1,51 @@
+// throughput of the validator and the text tools the command line tool is built on
+#include <thread>
+#include <vector>
+#include <json_minify.hpp>
+#include <json_validate.hpp>
+#include "test.hpp"
+
+int main(int argc, char** argv) {
+    std::string doc;
+    if(argc < 2 || !read_file(argv[1], doc)) {
+        fprintf(stderr, "usage: %s <json file>\n", argv[0]);
+        return 1;
+    }
+    measure("validate", doc.size(), [&] { json_validate(doc.data(), doc.size()); });
+    std::string output;
+    output.reserve(doc.size() * 2);
+    measure("minify", doc.size(), [&] {
+        text_stream input(doc);
+        output.clear();
+        string_stream out(output);
+        json_minify(input, out);
+    });
+    measure("pretty", doc.size(), [&] {
+        text_stream input(doc);
+        output.clear();
+        string_stream out(output);
+        json_reformat(input, out, 2);
+    });
+
+    // one document per worker at a time, like the command line tool
+    unsigned int workers = std::thread::hardware_concurrency();
+    if(workers == 0) {
+        workers = 1;
+    }
+    char name[64];
+    snprintf(name, sizeof(name), "validate, threads: %u", workers);
+    measure(name, doc.size() * workers * 4, [&] {
+        std::vector<std::thread> threads;
+        for(unsigned int i = 0; i < workers; ++i) {
+            threads.emplace_back([&] {
+                for(int j = 0; j < 4; ++j) {
+                    json_validate(doc.data(), doc.size());
+                }
+            });
+        }
+        for(std::thread& thread : threads) {
+            thread.join();
+        }
+    });
+    return 0;
+}
@@ -0,0 +1,87 @@
+// binds structs, including reusing one struct for several documents
+#include <json_bind.hpp>
+#include "test.hpp"
+
+namespace {
+struct inner {
+    json_optional<int> x;
+    json_array<int, 4> list;
+};
+struct outer {
+    int id;
+    json_optional<int> count;
+    json_optional<double> ratio;
+    json_optional<bool> flag;
+    json_optional<char[8]> label;
+    json_array<int, 4> nums;
+    inner child;
+    json_optional<inner> extra;
+};
+}
+namespace json {
+template <>
+struct json_binding<inner> {
+    static constexpr auto fields() {
+        return json_fields(json_field("x", &inner::x), json_field("list", &inner::list));
+    }
+};
+template <>
+struct json_binding<outer> {
+    static constexpr auto fields() {
+        return json_fields(json_field("id", &outer::id), json_field("count", &outer::count), json_field("ratio", &outer::ratio),
+                           json_field("flag", &outer::flag), json_field("label", &outer::label), json_field("nums", &outer::nums),
+                           json_field("child", &outer::child), json_field("extra", &outer::extra));
+    }
+};
+}
+
+namespace {
+bool bind(const char* text, outer& out) {
+    text_stream input(text);
+    json_reader_ex<32> reader(input);
+    return json_bind(reader, out);
+}
+}
+
+int main() {
+    outer out;
+    TEST_CHECK(bind("{\"id\":1,\"count\":7,\"ratio\":0.5,\"flag\":true,\"label\":\"abc\",\"nums\":[1,2,3],"
+                    "\"child\":{\"x\":4,\"list\":[5,6]},\"extra\":{\"x\":8,\"list\":[9]},\"unknown\":[{}]}",
+                    out));
+    TEST_CHECK(out.id == 1);
+    TEST_CHECK(out.count.has_value && out.count.value == 7);
+    TEST_CHECK(out.ratio.has_value && out.ratio.value == 0.5);
+    TEST_CHECK(out.flag.has_value && out.flag.value);
+    TEST_CHECK(out.label.has_value && 0 == strcmp(out.label.value, "abc"));
+    TEST_CHECK(out.nums.size == 3 && out.nums[0] == 1 && out.nums[2] == 3);
+    TEST_CHECK(out.child.x.has_value && out.child.x.value == 4);
+    TEST_CHECK(out.child.list.size == 2 && out.child.list[1] == 6);
+    TEST_CHECK(out.extra.has_value && out.extra.value.x.value == 8 && out.extra.value.list.size == 1);
+
+    // reused, members missing from the next document don't keep their old values
+    TEST_CHECK(bind("{\"id\":2}", out));
+    TEST_CHECK(out.id == 2);
+    TEST_CHECK(!out.count.has_value && !out.ratio.has_value && !out.flag.has_value && !out.label.has_value);
+    TEST_CHECK(out.nums.size == 0);
+    TEST_CHECK(!out.child.x.has_value && out.child.list.size == 0);
+    TEST_CHECK(!out.extra.has_value);
+
+    // and neither do members of a nested struct that is present
+    TEST_CHECK(bind("{\"child\":{\"x\":4,\"list\":[5,6]}}", out));
+    TEST_CHECK(bind("{\"child\":{}}", out));
+    TEST_CHECK(!out.child.x.has_value && out.child.list.size == 0);
+
+    // values of the wrong type don't count as present
+    TEST_CHECK(bind("{\"count\":\"seven\",\"ratio\":true,\"flag\":[1],\"label\":{\"a\":1},\"nums\":{},\"child\":{\"x\":[2]},\"extra\":5}", out));
+    TEST_CHECK(!out.count.has_value && !out.ratio.has_value && !out.flag.has_value && !out.label.has_value);
+    TEST_CHECK(out.nums.size == 0 && !out.child.x.has_value && !out.extra.has_value);
+
+    // nor do nulls
+    TEST_CHECK(bind("{\"count\":null,\"ratio\":null,\"flag\":null,\"label\":null,\"extra\":null}", out));
+    TEST_CHECK(!out.count.has_value && !out.ratio.has_value && !out.flag.has_value && !out.label.has_value && !out.extra.has_value);
+
+    // numbers convert between integers and reals
+    TEST_CHECK(bind("{\"count\":2.0,\"ratio\":3}", out));
+    TEST_CHECK(out.count.has_value && out.count.value == 2 && out.ratio.has_value && out.ratio.value == 3);
+    return test_result("bind");
+}
@@ -0,0 +1,151 @@
+// checks that CBOR transcoding gives the same output whether or not values are
+// split across a small capture buffer, and that split text stays whole UTF-8
+#include <json_cbor.hpp>
+#include <json_validate.hpp>
+#include <json_writer.hpp>
+#include "test.hpp"
+
+namespace {
+// true if the chunk neither starts nor ends partway through a UTF-8 sequence
+bool whole_utf8(const uint8_t* chunk, size_t size) {
+    if(size == 0) {
+        return true;
+    }
+    if((chunk[0] & 0xC0) == 0x80) {
+        return false;
+    }
+    size_t i = size;
+    while((chunk[i - 1] & 0xC0) == 0x80) {
+        --i;
+    }
+    uint8_t lead = chunk[i - 1];
+    size_t expected = lead < 0x80 ? 0 : lead >= 0xF0 ? 3 : lead >= 0xE0 ? 2 : 1;
+    return size - i == expected;
+}
+
+// true if every chunk of every indefinite length text string in the CBOR data is whole UTF-8
+bool chunks_whole_utf8(const std::string& cbor) {
+    const uint8_t* data = (const uint8_t*)cbor.data();
+    size_t pos = 0;
+    bool in_text = false;
+    while(pos < cbor.size()) {
+        uint8_t initial = data[pos++];
+        int major = initial >> 5;
+        int info = initial & 31;
+        if(info == 31) {
+            // an indefinite length item starts, or the break ends one
+            in_text = major == 3;
+            continue;
+        }
+        unsigned long long argument = info;
+        if(info >= 24) {
+            argument = 0;
+            for(int i = 0; i < (1 << (info - 24)); ++i) {
+                argument = (argument << 8) | data[pos++];
+            }
+        }
+        if(major == 2 || major == 3) {
+            if(major == 3 && in_text && !whole_utf8(data + pos, (size_t)argument)) {
+                return false;
+            }
+            pos += (size_t)argument;
+        }
+    }
+    return true;
+}
+
+template <size_t JsonCapture, size_t CborCapture>
+std::string through_cbor(const std::string& text) {
+    std::string cbor;
+    {
+        text_stream input(text);
+        string_stream output(cbor);
+        json_reader_ex<JsonCapture> reader(input);
+        TEST_CHECK(json_to_cbor(reader, output));
+    }
+    TEST_CHECK(chunks_whole_utf8(cbor));
+    std::string result;
+    text_stream input(cbor);
+    string_stream output(result);
+    cbor_reader_ex<CborCapture> reader(input);
+    json_writer writer(output);
+    TEST_CHECK(writer.write_all(reader));
+    return result;
+}
+
+// field names have to fit in the JSON reader's capture, so Small depends on the
+// document. the CBOR reader formats numbers whole, so its capture can't go below 25
+template <size_t Small>
+void check(const std::string& text) {
+    const std::string expected = through_cbor<1024, 1024>(text);
+    TEST_CHECK(json_validate(expected.data(), expected.size()) == json_error::none);
+    TEST_CHECK((through_cbor<Small, 1024>(text)) == expected);
+    TEST_CHECK((through_cbor<1024, 25>(text)) == expected);
+    TEST_CHECK((through_cbor<Small, 32>(text)) == expected);
+}
+
+// reads the first value of the CBOR data
+bool decode(const std::string& cbor, json_value_type* type, double* value, long long* integer = nullptr) {
+    text_stream input(cbor);
+    cbor_reader reader(input);
+    if(!reader.read() || reader.node_type() != json_node_type::value) {
+        return false;
+    }
+    *type = reader.value_type();
+    *value = reader.value_real();
+    if(integer != nullptr) {
+        *integer = reader.value_int();
+    }
+    return true;
+}
+
+bool same(double lhs, double rhs) {
+    return 0 == memcmp(&lhs, &rhs, sizeof(double));
+}
+}
+
+int main(int argc, char** argv) {
+    check<16>(test_document);
+    check<8>(test_array_document);
+    if(argc > 1) {
+        std::string doc;
+        TEST_CHECK(read_file(argv[1], doc));
+        check<32>(doc);
+    }
+
+    // every half precision float, against the arithmetic definition
+    json_value_type type;
+    double value;
+    long long integer;
+    for(uint32_t half = 0; half < 0x10000; ++half) {
+        const char bytes[] = {(char)0xF9, (char)(half >> 8), (char)half};
+        int exponent = (half >> 10) & 0x1F;
+        int mantissa = half & 0x3FF;
+        double expected = exponent == 0 ? ldexp(mantissa, -24) : exponent != 31 ? ldexp(mantissa + 1024, exponent - 25) : mantissa == 0 ? HUGE_VAL : NAN;
+        expected = (half & 0x8000) ? -expected : expected;
+        bool ok = decode(std::string(bytes, sizeof(bytes)), &type, &value) && type == json_value_type::real;
+        TEST_CHECK(ok && (expected != expected ? value != value : same(value, expected)));
+        if(test_failures > 20) {
+            break;
+        }
+    }
+
+    // integers past the range of a long long are reals, not clamped
+    TEST_CHECK(decode(std::string("\x1B\x7F\xFF\xFF\xFF\xFF\xFF\xFF\xFF", 9), &type, &value, &integer));
+    TEST_CHECK(type == json_value_type::integer && integer == 9223372036854775807LL);
+    TEST_CHECK(decode(std::string("\x3B\x7F\xFF\xFF\xFF\xFF\xFF\xFF\xFF", 9), &type, &value, &integer));
+    TEST_CHECK(type == json_value_type::integer && integer == -9223372036854775807LL - 1);
+    TEST_CHECK(decode(std::string("\x1B\x80\x00\x00\x00\x00\x00\x00\x00", 9), &type, &value));
+    TEST_CHECK(type == json_value_type::real && value == 9223372036854775808.0);
+    TEST_CHECK(decode(std::string("\x1B\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF", 9), &type, &value));
+    TEST_CHECK(type == json_value_type::real && value == 18446744073709551615.0);
+    TEST_CHECK(decode(std::string("\x3B\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF", 9), &type, &value));
+    TEST_CHECK(type == json_value_type::real && value == -18446744073709551616.0);
+
+    // a map count that doubles past 64 bits is an error, not an empty map
+    const std::string huge_map("\xBB\x80\x00\x00\x00\x00\x00\x00\x00", 9);
+    text_stream input(huge_map);
+    cbor_reader reader(input);
+    TEST_CHECK(!reader.read() && reader.error() == json_error::illegal_character);
+    return test_result("cbor");
+}
@@ -0,0 +1,35 @@
+# Writes the compressed inputs for tests/inflate.cpp with zlib.
+# The text must match sample() in tests/inflate.cpp.
+import os
+import zlib
+
+def sample():
+    out = ["["]
+    for i in range(120):
+        out.append('%s{"id":%d,"name":"item %d","tags":["alpha","beta"],"score":%d.%d,"ok":%s}' % (
+            "," if i else "", i, i * 7919 % 1000, (i * 37) % 100, i % 10, "true" if i % 3 else "false"))
+    out.append("]")
+    return "".join(out).encode()
+
+def compress(data, level, wbits, strategy=zlib.Z_DEFAULT_STRATEGY):
+    c = zlib.compressobj(level, zlib.DEFLATED, wbits, 9, strategy)
+    return c.compress(data) + c.flush()
+
+text = sample()
+half = len(text) // 2
+files = {
+    # dynamic Huffman blocks in a gzip member
+    "sample.json.gz": compress(text, 9, 31),
+    # zlib, fastest level
+    "sample.json.zz": compress(text, 1, 15),
+    # raw deflate with fixed Huffman blocks
+    "sample.json.deflate": compress(text, 9, -15, zlib.Z_FIXED),
+    # zlib with a 512 byte window
+    "sample.w9.zz": compress(text, 9, 9),
+    # two gzip members back to back
+    "sample.members.gz": compress(text[:half], 9, 31) + compress(text[half:], 9, 31),
+}
+here = os.path.dirname(os.path.abspath(__file__))
+for name, data in files.items():
+    with open(os.path.join(here, name), "wb") as f:
+        f.write(data)
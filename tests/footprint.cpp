@@ -0,0 +1,35 @@
+// the workload of examples/footprint, for measuring code size on the host.
+// built with -Os, once with the default dialect and once with the compact one
+#include <stdio.h>
+#include <string.h>
+#include <json.hpp>
+using namespace io;
+using namespace json;
+#ifdef HTCW_JSON_FOOTPRINT_COMPACT
+using reader_t = json_reader_ex<64, json_compact_dialect>;
+#else
+using reader_t = json_reader_ex<64>;
+#endif
+static const char* docs[] = {
+    "{\"id\":1,\"temp\":21.5,\"ok\":true}",
+    "{\"id\":2,\"temp\":-4.25e1,\"ok\":false}",
+    "{\"id\":3,\"temp\":1.0e-2,\"ok\":true}",
+    "{\"id\":4,\"temp\":99,\"ok\":null}"
+};
+constexpr static const size_t doc_count = sizeof(docs) / sizeof(docs[0]);
+int main() {
+    printf("sizeof(reader_t): %d bytes\n", (int)sizeof(reader_t));
+    for(size_t i = 0; i < doc_count; ++i) {
+        const_buffer_stream stream((const uint8_t*)docs[i], strlen(docs[i]));
+        reader_t reader(stream);
+        while(reader.read()) {
+            if(reader.node_type() == json_node_type::field && 0 == strcmp("temp", reader.value()) && reader.read()) {
+                printf("sensor %d: %f\n", (int)i + 1, (float)reader.value_real());
+            }
+        }
+        if(reader.error() != json_error::none) {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,140 @@
+// round trips through json_inflate_stream_ex. the compressed inputs in data/ are
+// made by data/make_inflate_data.py from the same sample text
+#include <json_inflate.hpp>
+#include "test.hpp"
+
+namespace {
+std::string sample() {
+    std::string result = "[";
+    char buffer[128];
+    for(int i = 0; i < 120; ++i) {
+        snprintf(buffer, sizeof(buffer), "%s{\"id\":%d,\"name\":\"item %d\",\"tags\":[\"alpha\",\"beta\"],\"score\":%d.%d,\"ok\":%s}",
+                 i ? "," : "", i, i * 7919 % 1000, (i * 37) % 100, i % 10, i % 3 ? "true" : "false");
+        result += buffer;
+    }
+    return result + "]";
+}
+
+// decompresses all of data, chunk bytes at a time
+template <unsigned int WindowBits = 15, size_t InputSize = 256>
+bool inflate(const std::string& data, std::string& result, size_t chunk = 1024, json_inflate_format format = json_inflate_format::automatic, json_inflate_format* detected = nullptr) {
+    text_stream input(data);
+    json_inflate_stream_ex<WindowBits, InputSize> stream(input, format);
+    uint8_t buffer[1024];
+    size_t read;
+    result.clear();
+    while((read = stream.read(buffer, chunk)) != 0) {
+        result.append((const char*)buffer, read);
+    }
+    if(detected != nullptr) {
+        *detected = stream.format();
+    }
+    return !stream.error() && stream.total() == result.size();
+}
+
+// raw deflate made of stored blocks of at most block_size bytes
+std::string store(const std::string& text, size_t block_size) {
+    std::string result;
+    size_t pos = 0;
+    do {
+        size_t size = text.size() - pos < block_size ? text.size() - pos : block_size;
+        bool final = pos + size == text.size();
+        result.push_back(final ? 1 : 0);
+        result.push_back((char)(size & 0xFF));
+        result.push_back((char)(size >> 8));
+        result.push_back((char)(~size & 0xFF));
+        result.push_back((char)((~size >> 8) & 0xFF));
+        result.append(text, pos, size);
+        pos += size;
+    } while(pos < text.size());
+    return result;
+}
+
+// every id in the sample, read through the stream by a reader
+int count_ids(const std::string& data) {
+    text_stream input(data);
+    json_inflate_stream inflated(input);
+    json_reader_ex<32> reader(inflated);
+    int result = 0;
+    while(reader.read()) {
+        if(reader.node_type() == json_node_type::field && 0 == strcmp("id", reader.value())) {
+            ++result;
+        }
+    }
+    return reader.error() == json_error::none && !inflated.error() ? result : -1;
+}
+}
+
+int main(int argc, char** argv) {
+    if(argc < 2) {
+        fprintf(stderr, "usage: %s <data directory>\n", argv[0]);
+        return 1;
+    }
+    const std::string text = sample();
+    struct {
+        const char* name;
+        json_inflate_format format;
+    } files[] = {
+        {"sample.json.gz", json_inflate_format::gzip},
+        {"sample.json.zz", json_inflate_format::zlib},
+        {"sample.json.deflate", json_inflate_format::raw},
+        {"sample.w9.zz", json_inflate_format::zlib},
+        {"sample.members.gz", json_inflate_format::gzip}};
+    std::string result;
+    for(const auto& file : files) {
+        std::string data;
+        TEST_CHECK(read_file((std::string(argv[1]) + "/" + file.name).c_str(), data));
+        json_inflate_format detected;
+        TEST_CHECK(inflate(data, result, 1024, json_inflate_format::automatic, &detected) && result == text);
+        TEST_CHECK(detected == file.format);
+        TEST_CHECK(inflate(data, result, 1024, file.format) && result == text);
+        // a byte at a time out, and a byte at a time in
+        TEST_CHECK(inflate(data, result, 1) && result == text);
+        TEST_CHECK((inflate<15, 1>(data, result, 7)) && result == text);
+        TEST_CHECK(count_ids(data) == 120);
+        // cut short anywhere, it's an error rather than a short read
+        for(size_t size = 0; size < data.size(); size += 1 + size / 5) {
+            TEST_CHECK(!inflate(data.substr(0, size), result));
+        }
+        // so is a damaged trailer
+        if(file.format != json_inflate_format::raw) {
+            std::string damaged = data;
+            damaged[damaged.size() - 1] ^= 1;
+            TEST_CHECK(!inflate(damaged, result));
+        }
+    }
+    std::string data;
+    // a small window is enough for data compressed with it, and too small otherwise
+    TEST_CHECK(read_file((std::string(argv[1]) + "/sample.w9.zz").c_str(), data));
+    TEST_CHECK((inflate<9>(data, result)) && result == text);
+    TEST_CHECK(read_file((std::string(argv[1]) + "/sample.json.zz").c_str(), data));
+    TEST_CHECK(!inflate<9>(data, result));
+
+    // stored blocks, including one of the largest size
+    std::string big;
+    while(big.size() < 150000) {
+        big += text;
+    }
+    TEST_CHECK(inflate(store(text, 1000), result, 1024, json_inflate_format::raw) && result == text);
+    TEST_CHECK(inflate(store(big, 65535), result, 1024, json_inflate_format::raw) && result == big);
+    TEST_CHECK(inflate(store("", 1), result, 1024, json_inflate_format::raw) && result.empty());
+    std::string damaged = store(text, 1000);
+    damaged[3] ^= 1;
+    TEST_CHECK(!inflate(damaged, result, 1024, json_inflate_format::raw));
+
+    // reset() starts over from the source's position
+    TEST_CHECK(read_file((std::string(argv[1]) + "/sample.json.gz").c_str(), data));
+    text_stream input(data);
+    json_inflate_stream stream(input);
+    uint8_t buffer[64];
+    TEST_CHECK(stream.read(buffer, sizeof(buffer)) == sizeof(buffer));
+    input.seek(0);
+    stream.reset();
+    result.clear();
+    size_t read;
+    while((read = stream.read(buffer, sizeof(buffer))) != 0) {
+        result.append((const char*)buffer, read);
+    }
+    TEST_CHECK(!stream.error() && result == text);
+    return test_result("inflate");
+}
@@ -0,0 +1,168 @@
+// checks that numbers are converted correctly rounded, the same as strtod()
+#include <float.h>
+#include <random>
+#include <json_ondemand.hpp>
+#include "test.hpp"
+
+namespace {
+// reads the one number in an array, which gives it an end_value_part when it's split
+template <typename Reader>
+bool parse(const char* text, double* result) {
+    std::string doc = std::string("[") + text + "]";
+    text_stream input(doc);
+    Reader reader(input);
+    bool found = false;
+    while(reader.read()) {
+        json_node_type nt = reader.node_type();
+        if(nt == json_node_type::value || nt == json_node_type::end_value_part) {
+            *result = reader.value_real();
+            found = true;
+        }
+    }
+    return found && reader.error() == json_error::none;
+}
+
+bool same(double lhs, double rhs) {
+    return 0 == memcmp(&lhs, &rhs, sizeof(double));
+}
+
+template <typename Reader>
+int check(const char* text) {
+    double expected = strtod(text, nullptr);
+    double actual = 0;
+    if(!parse<Reader>(text, &actual) || !same(actual, expected)) {
+        fprintf(stderr, "%s: read %.17g, expected %.17g\n", text, actual, expected);
+        return 1;
+    }
+    return 0;
+}
+
+// the same through an on demand value, which converts the number's text in one piece
+int check_ondemand(const char* text) {
+    double expected = strtod(text, nullptr);
+    double actual = 0;
+    json_ondemand_document doc(text, strlen(text));
+    if(!doc.root().get_real(&actual) || !same(actual, expected)) {
+        fprintf(stderr, "%s: got %.17g on demand, expected %.17g\n", text, actual, expected);
+        return 1;
+    }
+    return 0;
+}
+
+double from_bits(uint64_t bits) {
+    double result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+}
+
+int main() {
+    using reader_t = json_reader_ex<1024>;
+    using split_reader_t = json_reader_ex<16>;
+    using compact_reader_t = json_reader_ex<64, json_compact_dialect>;
+    double value = 0;
+
+    // the edges of the double range
+    TEST_CHECK(parse<reader_t>("1.7976931348623157e308", &value) && same(value, DBL_MAX));
+    TEST_CHECK(parse<reader_t>("5e-324", &value) && same(value, from_bits(1)));
+    TEST_CHECK(parse<reader_t>("4.9406564584124654e-324", &value) && same(value, from_bits(1)));
+    TEST_CHECK(parse<reader_t>("2.2250738585072014e-308", &value) && same(value, DBL_MIN));
+    TEST_CHECK(parse<reader_t>("2.2250738585072011e-308", &value) && same(value, from_bits(0x000FFFFFFFFFFFFFULL)));
+    TEST_CHECK(parse<reader_t>("-1.7976931348623157e308", &value) && same(value, -DBL_MAX));
+    TEST_CHECK(parse<reader_t>("1.7976931348623158e308", &value) && same(value, DBL_MAX));
+    TEST_CHECK(parse<reader_t>("1.7976931348623159e308", &value) && value > DBL_MAX);
+    TEST_CHECK(parse<reader_t>("1e400", &value) && value > DBL_MAX);
+    TEST_CHECK(parse<reader_t>("1e-400", &value) && same(value, 0.0));
+    TEST_CHECK(parse<reader_t>("-0.0", &value) && same(value, -0.0));
+    // half the smallest subnormal is a tie, and rounds to even (zero)
+    TEST_CHECK(parse<reader_t>("2.4703282292062327e-324", &value) && same(value, 0.0));
+    TEST_CHECK(parse<reader_t>("2.4703282292062328e-324", &value) && same(value, from_bits(1)));
+    TEST_CHECK(parse<compact_reader_t>("1.7976931348623157e308", &value) && same(value, DBL_MAX));
+    TEST_CHECK(parse<compact_reader_t>("5e-324", &value) && same(value, from_bits(1)));
+    TEST_CHECK(parse<compact_reader_t>("2.2250738585072014e-308", &value) && same(value, DBL_MIN));
+
+    const char* cases[] = {
+        "0.1", "0.30000000000000004", "1e23", "8.98846567431158e307", "9007199254740993",
+        "9007199254740992.5", "123456789012345678901234567890", "7.2057594037927933e16",
+        "3.333333333333333314829616256247390992939472198486328125e-1",
+        "1797693134862315807937289714053034150799341327100378269361737789804449682927647509466490179775872070963302864166928879109465555478519404026306574886715058206819089020007083836762738548458177115317644757302700698555713669596228429148198608349364752927190741684443655107043427115596995080930428801779041744977919999999999999999999999999999e-2"};
+    for(const char* text : cases) {
+        test_failures += check<reader_t>(text);
+        test_failures += check<compact_reader_t>(text);
+        if(strlen(text) < 64) {
+            test_failures += check_ondemand(text);
+        }
+    }
+
+    // random doubles at every precision, whole in the capture and split into parts.
+    // split numbers past 19 digits can't revisit their dropped digits, so they stop at 18
+    std::mt19937_64 rng(8259);
+    char text[64];
+    for(int i = 0; i < 200000 && test_failures < 20; ++i) {
+        double d = from_bits(rng());
+        if(d != d || d - d != 0) {
+            continue;
+        }
+        int precision = (int)(rng() % 21);
+        snprintf(text, sizeof(text), "%.*e", precision, d);
+        test_failures += check<reader_t>(text);
+        if(precision <= 18) {
+            test_failures += check<split_reader_t>(text);
+        }
+        if(i % 8 == 0) {
+            test_failures += check<compact_reader_t>(text);
+            test_failures += check_ondemand(text);
+        }
+    }
+
+    // exact halfway points between neighbouring doubles, and numbers a hair on
+    // either side, with hundreds of digits. needs a long double to hold them
+#if LDBL_MANT_DIG >= 54
+    std::string digits;
+    for(int i = 0; i < 2000 && test_failures < 20; ++i) {
+        uint64_t bits = rng() >> 1;
+        double low = from_bits(bits);
+        double high = from_bits(bits + 1);
+        if(low != low || high - high != 0) {
+            continue;
+        }
+        long double halfway = ((long double)low + (long double)high) / 2;
+        char buffer[1024];
+        snprintf(buffer, sizeof(buffer), "%.780Le", halfway);
+        test_failures += check<reader_t>(buffer);
+        // just above: a 1 after the last significant digit
+        std::string mantissa(buffer, strchr(buffer, 'e'));
+        std::string exponent(strchr(buffer, 'e'));
+        size_t last = mantissa.find_last_not_of('0');
+        if(last + 1 < mantissa.size()) {
+            std::string above = mantissa.substr(0, last + 1) + "1" + exponent;
+            test_failures += check<reader_t>(above.c_str());
+        }
+        // truncated, which is just below
+        for(size_t keep : {17, 20, 40, 120}) {
+            if(keep < last) {
+                std::string below = mantissa.substr(0, keep) + exponent;
+                test_failures += check<reader_t>(below.c_str());
+            }
+        }
+    }
+#endif
+
+    // integers stay integers until they don't fit
+    text_stream ints("[9223372036854775807,-9223372036854775807,92233720368547758070]");
+    reader_t reader(ints);
+    TEST_CHECK(reader.read() && reader.read() && reader.value_type() == json_value_type::integer && reader.value_int() == 9223372036854775807LL);
+    TEST_CHECK(reader.read() && reader.value_type() == json_value_type::integer && reader.value_int() == -9223372036854775807LL);
+    TEST_CHECK(reader.read() && reader.value_type() == json_value_type::real && same(reader.value_real(), 92233720368547758070.0));
+    // on demand, integers that don't fit aren't integers
+    const char* limits =
+        "[9223372036854775807,-9223372036854775808,9223372036854775808,-9223372036854775809,99999999999999999999,-0]";
+    json_ondemand_document doc(limits, strlen(limits));
+    long long i64 = 0;
+    TEST_CHECK(doc.at(0).get_int(&i64) && i64 == 9223372036854775807LL);
+    TEST_CHECK(doc.at(1).get_int(&i64) && i64 == -9223372036854775807LL - 1);
+    TEST_CHECK(!doc.at(2).get_int(&i64) && !doc.at(3).get_int(&i64) && !doc.at(4).get_int(&i64));
+    TEST_CHECK(doc.at(5).get_int(&i64) && i64 == 0);
+    TEST_CHECK(doc.at(4).get_real(&value) && same(value, 99999999999999999999.0));
+    return test_result("numbers");
+}
@@ -0,0 +1,118 @@
+// shared helpers for the tests and benchmarks
+#ifndef HTCW_JSON_TEST_HPP
+#define HTCW_JSON_TEST_HPP
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <json.hpp>
+using namespace json;
+
+namespace {
+int test_failures = 0;
+
+#define TEST_CHECK(condition)                                                  \
+    do {                                                                       \
+        if(!(condition)) {                                                    \
+            ++test_failures;                                                   \
+            fprintf(stderr, "%s:%d: failed: %s\n", __FILE__, __LINE__, #condition); \
+        }                                                                      \
+    } while(0)
+
+// reports the result and gives the exit code
+inline int test_result(const char* name) {
+    if(test_failures != 0) {
+        fprintf(stderr, "%s: %d failed\n", name, test_failures);
+        return 1;
+    }
+    printf("%s: ok\n", name);
+    return 0;
+}
+
+// an output stream that appends to a string
+class string_stream final : public stream {
+    std::string* m_target;
+public:
+    string_stream(std::string& target) : m_target(&target) {
+    }
+    virtual int getch() override {
+        return -1;
+    }
+    virtual size_t read(uint8_t*, size_t) override {
+        return 0;
+    }
+    virtual int putch(int value) override {
+        m_target->push_back((char)value);
+        return value;
+    }
+    virtual size_t write(const uint8_t* data, size_t size) override {
+        m_target->append((const char*)data, size);
+        return size;
+    }
+    virtual unsigned long long seek(long long, io::seek_origin = io::seek_origin::start) override {
+        return m_target->size();
+    }
+    virtual io::stream_caps caps() const override {
+        io::stream_caps result;
+        result.read = 0;
+        result.write = 1;
+        result.seek = 0;
+        return result;
+    }
+};
+
+// a read only stream over a string
+class text_stream final : public io::const_buffer_stream {
+public:
+    text_stream(const std::string& text) : io::const_buffer_stream((const uint8_t*)text.data(), text.size()) {
+    }
+    text_stream(const char* text) : io::const_buffer_stream((const uint8_t*)text, strlen(text)) {
+    }
+};
+
+// values of every kind, with escapes, multibyte UTF-8 and long numbers and strings
+const char* const test_document =
+    "{\"short\":\"abc\",\"escapes\":\"tab\\there \\\"quoted\\\" back\\\\slash \\u00e9\\ud83d\\ude00 \\/\","
+    "\"utf8\":\"\xc3\xa9t\xc3\xa9 \xe2\x82\xac\xe2\x82\xac\xe2\x82\xac \xf0\x9f\x98\x80\xf0\x9f\x98\x80 \xe4\xb8\xad\xe6\x96\x87\xe4\xb8\xad\xe6\x96\x87\","
+    "\"numbers\":[1,-2,3.5,-4.25e-3,1e300,"
+    "123456789012345678901234567890,-9223372036854775807,0.000000000000000000000012345678901234567],"
+    "\"literals\":[true,false,null,\"true\"],\"nested\":{\"a\":{\"b\":[[],{},[{}]]}},"
+    "\"long\":\"abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz\"}";
+// without field names, which have to fit in the capture
+const char* const test_array_document =
+    "[\"tab\\there \\\"quoted\\\" \\u00e9\\ud83d\\ude00\",\"\xe2\x82\xac\xe2\x82\xac\xe2\x82\xac\xf0\x9f\x98\x80\xf0\x9f\x98\x80\","
+    "-4.25e-3,123456789012345678901234567890,-9223372036854775807,[true,false,null],\"abcdefghijklmnopqrstuvwxyz\"]";
+
+// runs the work repeatedly for at least a quarter second and reports the rate
+template <typename Work>
+void measure(const char* name, size_t bytes, Work work) {
+    using clock = std::chrono::steady_clock;
+    size_t runs = 0;
+    clock::time_point start = clock::now();
+    double elapsed;
+    do {
+        work();
+        ++runs;
+        elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    } while(elapsed < .25);
+    printf("%-28s %9.1f MB/s\n", name, (double)bytes * runs / elapsed / (1024 * 1024));
+}
+
+inline bool read_file(const char* path, std::string& result) {
+    FILE* file = fopen(path, "rb");
+    if(file == nullptr) {
+        fprintf(stderr, "cannot read %s\n", path);
+        return false;
+    }
+    char buffer[4096];
+    size_t read;
+    result.clear();
+    while((read = fread(buffer, 1, sizeof(buffer), file)) != 0) {
+        result.append(buffer, read);
+    }
+    fclose(file);
+    return true;
+}
+}
+#endif // HTCW_JSON_TEST_HPP
@@ -0,0 +1,91 @@
+// checks json_validate() and the strict reader against each other and against the grammar
+#include <json_validate.hpp>
+#include "test.hpp"
+
+namespace {
+template <typename Reader>
+bool reader_accepts(const std::string& text) {
+    text_stream input(text);
+    Reader reader(input);
+    while(reader.read());
+    return reader.error() == json_error::none;
+}
+
+// feeds the validator one byte at a time
+template <size_t MaxDepth>
+json_error validate_bytewise(const std::string& text) {
+    json_validator_ex<MaxDepth> validator;
+    for(size_t i = 0; i < text.size(); ++i) {
+        if(!validator.feed(text.data() + i, 1)) {
+            return validator.error();
+        }
+    }
+    validator.finish();
+    return validator.error();
+}
+
+// the same nesting limit for the validator and the reader
+template <size_t MaxDepth = 256>
+void check(const std::string& text, bool valid) {
+    using reader_t = json_reader_ex<64, json_dialect<json_strings::runtime, json_grammar::strict, true, MaxDepth>>;
+    bool validator = json_validate<MaxDepth>(text.data(), text.size()) == json_error::none;
+    bool bytewise = validate_bytewise<MaxDepth>(text) == json_error::none;
+    bool reader = reader_accepts<reader_t>(text);
+    if(validator != valid || bytewise != valid || reader != valid) {
+        ++test_failures;
+        fprintf(stderr, "%.60s (%zu bytes): expected %s, validator %d, bytewise %d, reader %d\n", text.c_str(), text.size(), valid ? "valid" : "invalid", validator, bytewise, reader);
+    }
+}
+}
+
+int main(int argc, char** argv) {
+    const char* valid[] = {
+        "{}", "[]", "0", "-0", "1.5e-3", "-1.0E+2", "\"x\"", "true", "false", "null", " [ ] ",
+        "[1,2]", "{\"a\":1,\"b\":[true,false,null]}", "{\"\":\"\"}", "\"\\u00e9\\ud83d\\ude00\"",
+        "\"\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80\"", "{\"a\":{\"b\":{\"c\":[[[]]]}}}", "[1]\n",
+        "[{\"a\":[1,{\"b\":2}]},{\"c\":[]},[{}]]", "{\"a\":[],\"b\":{},\"c\":\"d\"}"};
+    const char* invalid[] = {
+        "[1 2]", "{\"b\":[1 2]}", "[1]]", "{\"a\":1}{\"b\":2}", "1 2", "{\"a\":1 \"b\":2}", "]", "}", "[1,2] ,",
+        "[1,]", "{\"a\":1,}", "{\"a\"}", "{\"a\" 1}", "{1:2}", "[01]", "[1.]", "[.5]", "[-]", "[1e]", "[+1]",
+        "[tru]", "[nul]", "[True]", "\"abc", "[\"a\\x\"]", "[", "{", "{\"a\":", "[1,", "{\"a\":1", "{\"a\":[1,2]",
+        "/*c*/[]", "[NaN]", "[Infinity]", "['a']", "[1]x", "\"\\u12\"", "[0x10]",
+        // brackets and fields have to match the open container
+        "{\"a\":1]", "[{\"a\":1]}", "[1}", "{\"a\":[1}}", "{\"a\":1,2}", "[\"a\":2]", "[1,\"a\":2]", "{\"a\":1,\"b\"}",
+        "{\"a\":1,\"b\":2,[]}", "\"a\":1", "{\"a\":{\"b\":1,\"c\"}}",
+        // control characters have to be escaped
+        "\"a\tb\"", "[\"\x01\"]", "{\"a\x1f\":1}"};
+    for(const char* text : valid) {
+        check(text, true);
+    }
+    for(const char* text : invalid) {
+        check(text, false);
+    }
+    // nesting counts arrays and objects together
+    check<4>("[[[[1]]]]", true);
+    check<4>("{\"a\":[{\"b\":[1]}]}", true);
+    check<4>("[[[[[1]]]]]", false);
+    check<4>("{\"a\":[{\"b\":[{}]}]}", false);
+    // the default limit is the same for both
+    check(std::string(256, '[') + std::string(256, ']'), true);
+    check(std::string(257, '[') + std::string(257, ']'), false);
+    // the validator also checks what the reader lets through
+    const char* encoding[] = {"\"\xc3\"", "\"\xff\"", "\"\xed\xa0\x80\"", "\"\xc0\xaf\"", "\"\xf4\x90\x80\x80\""};
+    for(const char* text : encoding) {
+        TEST_CHECK(json_validate(text, strlen(text)) != json_error::none);
+    }
+    // the first problem is reported where it is
+    unsigned long long offset = 0;
+    TEST_CHECK(json_validate("[1,2 3]", 7, &offset) == json_error::illegal_character && offset == 5);
+
+    if(argc > 1) {
+        std::string doc;
+        TEST_CHECK(read_file(argv[1], doc));
+        check(doc, true);
+        size_t end = doc.find_last_not_of(" \t\r\n") + 1;
+        // every cut short copy is invalid
+        for(size_t size = 1; size < end; size += 1 + size / 7) {
+            check(doc.substr(0, size), false);
+        }
+    }
+    return test_result("validate");
+}
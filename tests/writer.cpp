@@ -0,0 +1,62 @@
+// checks that the writer gives the same output whether or not values are split
+// across a small capture buffer
+#include <json_writer.hpp>
+#include <json_validate.hpp>
+#include <json_pipeline.hpp>
+#include "test.hpp"
+
+namespace {
+template <size_t CaptureSize>
+std::string rewrite(const std::string& text, bool raw, unsigned int indent = 0) {
+    std::string result;
+    text_stream input(text);
+    string_stream output(result);
+    json_reader_ex<CaptureSize> reader(input);
+    reader.raw_strings(raw);
+    json_writer writer(output, indent);
+    TEST_CHECK(writer.write_all(reader));
+    return result;
+}
+
+// field names have to fit in the capture with room to spare, so Small depends on the document
+template <size_t Small>
+void check(const std::string& text) {
+    for(bool raw : {false, true}) {
+        const std::string expected = rewrite<1024>(text, raw);
+        TEST_CHECK(json_validate(expected.data(), expected.size()) == json_error::none);
+        TEST_CHECK(rewrite<Small>(text, raw) == expected);
+        TEST_CHECK(rewrite<Small + 8>(text, raw) == expected);
+        TEST_CHECK(rewrite<48>(text, raw) == expected);
+        // written output reads back to itself
+        TEST_CHECK(rewrite<1024>(expected, raw) == expected);
+        // indenting only adds whitespace
+        TEST_CHECK(rewrite<Small>(rewrite<Small>(text, raw, 2), raw) == expected);
+    }
+}
+}
+
+int main(int argc, char** argv) {
+    check<16>(test_document);
+    check<8>(test_array_document);
+    if(argc > 1) {
+        std::string doc;
+        TEST_CHECK(read_file(argv[1], doc));
+        check<32>(doc);
+    }
+
+    // pipeline stages pass strings through raw, so a decoded source is refused
+    // rather than written out unquoted
+    for(bool decoded : {false, true}) {
+        std::string result;
+        text_stream input(test_document);
+        string_stream output(result);
+        json_reader_ex<64> runtime_reader(input);
+        json_reader_ex<64, json_dialect<json_strings::decoded>> decoded_reader(input);
+        json_drop drop(decoded ? (json_reader_base&)decoded_reader : runtime_reader, "numbers");
+        json_writer writer(output);
+        TEST_CHECK(writer.write_all(drop) == !decoded);
+        TEST_CHECK(drop.error() == (decoded ? json_error::illegal_encoding : json_error::none));
+        TEST_CHECK(decoded ? result.empty() : json_validate(result.data(), result.size()) == json_error::none);
+    }
+    return test_result("writer");
+}
@@ -0,0 +1,553 @@
+// htcw_json command line tool
+// htcw_json <validate|minify|pretty|query <path>|stats> [-j threads] [--indent n] [files or directories...]
+// Files are parsed concurrently, one reader per worker, and the output is written in the order the files were given.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <json.hpp>
+#include <json_minify.hpp>
+#include <json_path.hpp>
+#include <json_validate.hpp>
+#include <json_writer.hpp>
+using namespace json;
+
+namespace {
+// files at least this big are mapped instead of read
+constexpr static const size_t mmap_threshold = 64 * 1024;
+// how many files can be finished ahead of the one being written
+constexpr static const size_t output_window = 64;
+
+enum struct command {
+    validate,
+    minify,
+    pretty,
+    query,
+    stats
+};
+
+const char* error_name(json_error error) {
+    switch(error) {
+        case json_error::none: return "none";
+        case json_error::unterminated_object: return "unterminated object";
+        case json_error::unterminated_array: return "unterminated array";
+        case json_error::unterminated_string: return "unterminated string";
+        case json_error::unterminated_element: return "unterminated element";
+        case json_error::illegal_literal: return "illegal literal";
+        case json_error::illegal_character: return "illegal character";
+        case json_error::field_too_long: return "field too long";
+        case json_error::field_missing_value: return "field missing value";
+        case json_error::nesting_too_deep: return "nesting too deep";
+        case json_error::illegal_encoding: return "illegal encoding";
+        case json_error::buffer_too_small: return "buffer too small";
+    }
+    return "unknown";
+}
+
+// an output stream that appends to a string
+class string_stream final : public stream {
+    std::string* m_target;
+public:
+    string_stream(std::string& target) : m_target(&target) {
+    }
+    virtual int getch() override {
+        return -1;
+    }
+    virtual size_t read(uint8_t*, size_t) override {
+        return 0;
+    }
+    virtual int putch(int value) override {
+        m_target->push_back((char)value);
+        return value;
+    }
+    virtual size_t write(const uint8_t* data, size_t size) override {
+        m_target->append((const char*)data, size);
+        return size;
+    }
+    virtual unsigned long long seek(long long, io::seek_origin = io::seek_origin::start) override {
+        return m_target->size();
+    }
+    virtual io::stream_caps caps() const override {
+        io::stream_caps result;
+        result.read = 0;
+        result.write = 1;
+        result.seek = 0;
+        return result;
+    }
+};
+
+// the contents of a file, mapped or read
+class file_data final {
+    const char* m_data;
+    size_t m_size;
+    bool m_mapped;
+    std::string m_buffer;
+    file_data(const file_data&) = delete;
+    file_data& operator=(const file_data&) = delete;
+public:
+    file_data() : m_data(nullptr), m_size(0), m_mapped(false) {
+    }
+    ~file_data() {
+        if(m_mapped) {
+            munmap((void*)m_data, m_size);
+        }
+    }
+    bool open(const char* path) {
+        int fd = strcmp(path, "-") == 0 ? 0 : ::open(path, O_RDONLY);
+        if(fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if(fd != 0 && fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && (size_t)st.st_size >= mmap_threshold) {
+            void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(p != MAP_FAILED) {
+                madvise(p, st.st_size, MADV_SEQUENTIAL);
+                close(fd);
+                m_data = (const char*)p;
+                m_size = st.st_size;
+                m_mapped = true;
+                return true;
+            }
+        }
+        char buf[16 * 1024];
+        ssize_t count;
+        while((count = ::read(fd, buf, sizeof(buf))) > 0) {
+            m_buffer.append(buf, count);
+        }
+        if(fd != 0) {
+            close(fd);
+        }
+        if(count < 0) {
+            return false;
+        }
+        m_data = m_buffer.data();
+        m_size = m_buffer.size();
+        return true;
+    }
+    const char* data() const {
+        return m_data;
+    }
+    size_t size() const {
+        return m_size;
+    }
+};
+
+// a pool where each worker has its own queue and steals from the others when it runs dry
+class work_stealing_pool final {
+    struct queue {
+        std::mutex lock;
+        std::deque<size_t> items;
+    };
+    std::vector<std::unique_ptr<queue>> m_queues;
+    std::vector<std::thread> m_threads;
+    std::function<void(size_t, size_t)> m_run;
+    std::mutex m_idle_lock;
+    std::condition_variable m_idle;
+    std::atomic<size_t> m_pending;
+    size_t m_next;
+    bool m_closed;
+    bool take(size_t self, size_t* item) {
+        // own work from the front, stolen work from the back
+        {
+            queue& q = *m_queues[self];
+            std::lock_guard<std::mutex> guard(q.lock);
+            if(!q.items.empty()) {
+                *item = q.items.front();
+                q.items.pop_front();
+                return true;
+            }
+        }
+        for(size_t i = 1; i < m_queues.size(); ++i) {
+            queue& q = *m_queues[(self + i) % m_queues.size()];
+            std::lock_guard<std::mutex> guard(q.lock);
+            if(!q.items.empty()) {
+                *item = q.items.back();
+                q.items.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+    void work(size_t self) {
+        while(true) {
+            size_t item;
+            if(take(self, &item)) {
+                --m_pending;
+                m_run(self, item);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(m_idle_lock);
+            m_idle.wait(lock, [this] { return m_closed || m_pending > 0; });
+            if(m_closed && m_pending == 0) {
+                return;
+            }
+        }
+    }
+public:
+    // run is called with the worker index and the item
+    work_stealing_pool(size_t threads, std::function<void(size_t, size_t)> run) : m_run(run), m_pending(0), m_next(0), m_closed(false) {
+        for(size_t i = 0; i < threads; ++i) {
+            m_queues.emplace_back(new queue());
+        }
+        for(size_t i = 0; i < threads; ++i) {
+            m_threads.emplace_back(&work_stealing_pool::work, this, i);
+        }
+    }
+    ~work_stealing_pool() {
+        {
+            std::lock_guard<std::mutex> guard(m_idle_lock);
+            m_closed = true;
+        }
+        m_idle.notify_all();
+        for(std::thread& t : m_threads) {
+            t.join();
+        }
+    }
+    void submit(size_t item) {
+        // counted before it's queued so a worker never takes it first
+        {
+            std::lock_guard<std::mutex> guard(m_idle_lock);
+            ++m_pending;
+        }
+        queue& q = *m_queues[m_next++ % m_queues.size()];
+        {
+            std::lock_guard<std::mutex> guard(q.lock);
+            q.items.push_back(item);
+        }
+        m_idle.notify_one();
+    }
+};
+
+struct file_stats {
+    unsigned long long bytes = 0;
+    unsigned long long nodes = 0;
+    unsigned long long objects = 0;
+    unsigned long long arrays = 0;
+    unsigned long long fields = 0;
+    unsigned long long strings = 0;
+    unsigned long long numbers = 0;
+    unsigned long long booleans = 0;
+    unsigned long long nulls = 0;
+    size_t max_level = 0;
+    void add(const file_stats& rhs) {
+        bytes += rhs.bytes;
+        nodes += rhs.nodes;
+        objects += rhs.objects;
+        arrays += rhs.arrays;
+        fields += rhs.fields;
+        strings += rhs.strings;
+        numbers += rhs.numbers;
+        booleans += rhs.booleans;
+        nulls += rhs.nulls;
+        max_level = std::max(max_level, rhs.max_level);
+    }
+};
+
+struct job {
+    const char* path;
+    std::string output;
+    std::string message;
+    file_stats stats;
+    bool ok = false;
+    bool done = false;
+};
+
+struct options {
+    command cmd;
+    const char* query = nullptr;
+    unsigned int indent = 2;
+    size_t threads = 0;
+    bool label = false;
+};
+
+// writes the value under the cursor, including any children
+bool write_value(json_reader& reader, json_path& path, json_writer& writer) {
+    json_node_type first = reader.node_type();
+    if(!writer.write(reader)) {
+        return false;
+    }
+    if(first == json_node_type::value) {
+        return true;
+    }
+    // for containers the path has already counted this one
+    size_t level = path.level();
+    while(reader.read()) {
+        path.update(reader);
+        if(!writer.write(reader)) {
+            return false;
+        }
+        json_node_type nt = reader.node_type();
+        if(first == json_node_type::value_part) {
+            if(nt == json_node_type::end_value_part) {
+                return true;
+            }
+        } else if((nt == json_node_type::end_array || nt == json_node_type::end_object) && path.level() < level) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void process(const options& opts, json_reader& reader, job& j) {
+    file_data file;
+    if(!file.open(j.path)) {
+        j.message = std::string(j.path) + ": cannot read file";
+        return;
+    }
+    io::const_buffer_stream input((const uint8_t*)file.data(), file.size());
+    reader.reset(input);
+    reader.raw_strings(true);
+    string_stream output(j.output);
+    json_error error = json_error::none;
+    unsigned long long offset = 0;
+    switch(opts.cmd) {
+        case command::validate:
+            // the validator checks the whole grammar without producing nodes
+            error = json_validate(file.data(), file.size(), &offset);
+            break;
+        case command::minify:
+        case command::pretty:
+            // straight from text to text, without going through the reader
+            if(json_reformat<256, 4096>(input, output, opts.cmd == command::pretty ? opts.indent : 0, &error, &offset)) {
+                output.putch('\n');
+            }
+            break;
+        case command::query: {
+            json_path path(opts.query);
+            while(reader.read()) {
+                if(path.update(reader)) {
+                    if(opts.label) {
+                        j.output.append(j.path);
+                        j.output.append(": ");
+                    }
+                    json_writer writer(output);
+                    if(!write_value(reader, path, writer)) {
+                        break;
+                    }
+                    output.putch('\n');
+                } else if((reader.node_type() == json_node_type::array || reader.node_type() == json_node_type::object) && !path.prefix_matched()) {
+                    // nothing inside can match
+                    if(!reader.skip_value()) {
+                        break;
+                    }
+                    path.update(reader);
+                }
+            }
+            break;
+        }
+        case command::stats: {
+            file_stats& s = j.stats;
+            s.bytes = file.size();
+            json_path path("");
+            while(reader.read()) {
+                path.update(reader);
+                ++s.nodes;
+                switch(reader.node_type()) {
+                    case json_node_type::object:
+                        ++s.objects;
+                        break;
+                    case json_node_type::array:
+                        ++s.arrays;
+                        break;
+                    case json_node_type::field:
+                        ++s.fields;
+                        break;
+                    case json_node_type::value:
+                    case json_node_type::end_value_part:
+                        switch(reader.value_type()) {
+                            case json_value_type::none:
+                                ++s.strings;
+                                break;
+                            case json_value_type::null:
+                                ++s.nulls;
+                                break;
+                            case json_value_type::boolean:
+                                ++s.booleans;
+                                break;
+                            default:
+                                ++s.numbers;
+                                break;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+                s.max_level = std::max(s.max_level, path.level());
+            }
+            char buf[256];
+            snprintf(buf, sizeof(buf), "%s: %llu bytes, %llu nodes, %llu objects, %llu arrays, %llu fields, %llu strings, %llu numbers, %llu booleans, %llu nulls, depth %zu\n",
+                     j.path, s.bytes, s.nodes, s.objects, s.arrays, s.fields, s.strings, s.numbers, s.booleans, s.nulls, s.max_level);
+            j.output.append(buf);
+            break;
+        }
+    }
+    if(reader.error() != json_error::none) {
+        error = reader.error();
+        offset = reader.error_offset();
+    }
+    if(error != json_error::none) {
+        unsigned long line = 1;
+        const char* line_start = file.data();
+        const char* end = file.data() + std::min((size_t)offset, file.size());
+        const char* nl;
+        while(line_start < end && (nl = (const char*)memchr(line_start, '\n', end - line_start)) != nullptr) {
+            ++line;
+            line_start = nl + 1;
+        }
+        char buf[128];
+        snprintf(buf, sizeof(buf), ": %s at line %lu, column %lu (offset %llu)", error_name(error), line, (unsigned long)(end - line_start) + 1, offset);
+        j.message = std::string(j.path) + buf;
+        if(opts.cmd != command::stats) {
+            j.output.clear();
+        }
+        return;
+    }
+    if(opts.cmd == command::validate) {
+        j.output = std::string(j.path) + ": ok\n";
+    }
+    j.ok = true;
+}
+
+void collect(const char* path, std::vector<std::string>& files) {
+    struct stat st;
+    if(strcmp(path, "-") != 0 && stat(path, &st) == 0 && S_ISDIR(st.st_mode)) {
+        DIR* dir = opendir(path);
+        if(dir == nullptr) {
+            files.push_back(path);
+            return;
+        }
+        std::vector<std::string> entries;
+        struct dirent* ent;
+        while((ent = readdir(dir)) != nullptr) {
+            if(ent->d_name[0] == '.') {
+                continue;
+            }
+            std::string child = std::string(path) + "/" + ent->d_name;
+            size_t len = strlen(ent->d_name);
+            if((stat(child.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) || (len > 5 && strcmp(ent->d_name + len - 5, ".json") == 0)) {
+                entries.push_back(child);
+            }
+        }
+        closedir(dir);
+        std::sort(entries.begin(), entries.end());
+        for(const std::string& e : entries) {
+            collect(e.c_str(), files);
+        }
+        return;
+    }
+    files.push_back(path);
+}
+
+int usage() {
+    fputs("usage: htcw_json <validate|minify|pretty|query <path>|stats> [-j threads] [--indent n] [files or directories...]\n", stderr);
+    return 2;
+}
+}
+
+int main(int argc, char** argv) {
+    if(argc < 2) {
+        return usage();
+    }
+    options opts;
+    int arg = 2;
+    if(strcmp(argv[1], "validate") == 0) {
+        opts.cmd = command::validate;
+    } else if(strcmp(argv[1], "minify") == 0) {
+        opts.cmd = command::minify;
+    } else if(strcmp(argv[1], "pretty") == 0) {
+        opts.cmd = command::pretty;
+    } else if(strcmp(argv[1], "stats") == 0) {
+        opts.cmd = command::stats;
+    } else if(strcmp(argv[1], "query") == 0 && argc > 2) {
+        opts.cmd = command::query;
+        opts.query = argv[arg++];
+        if(!json_path(opts.query).valid()) {
+            fprintf(stderr, "htcw_json: invalid path \"%s\"\n", opts.query);
+            return 2;
+        }
+    } else {
+        return usage();
+    }
+    std::vector<std::string> files;
+    for(; arg < argc; ++arg) {
+        if(strcmp(argv[arg], "-j") == 0 && arg + 1 < argc) {
+            opts.threads = (size_t)atoi(argv[++arg]);
+        } else if(strcmp(argv[arg], "--indent") == 0 && arg + 1 < argc) {
+            opts.indent = (unsigned int)atoi(argv[++arg]);
+        } else {
+            collect(argv[arg], files);
+        }
+    }
+    if(files.empty()) {
+        files.push_back("-");
+    }
+    opts.label = files.size() > 1;
+    if(opts.threads == 0) {
+        opts.threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    opts.threads = std::min(opts.threads, files.size());
+
+    std::vector<job> jobs(files.size());
+    for(size_t i = 0; i < files.size(); ++i) {
+        jobs[i].path = files[i].c_str();
+    }
+    std::vector<std::unique_ptr<json_reader>> readers;
+    for(size_t i = 0; i < opts.threads; ++i) {
+        readers.emplace_back(new json_reader());
+    }
+    std::mutex done_lock;
+    std::condition_variable done;
+    int result = 0;
+    file_stats totals;
+    {
+        work_stealing_pool pool(opts.threads, [&](size_t worker, size_t item) {
+            process(opts, *readers[worker], jobs[item]);
+            {
+                std::lock_guard<std::mutex> guard(done_lock);
+                jobs[item].done = true;
+            }
+            done.notify_all();
+        });
+        size_t submitted = 0;
+        for(size_t i = 0; i < jobs.size(); ++i) {
+            // keep a bounded number of finished outputs waiting
+            while(submitted < jobs.size() && submitted < i + output_window) {
+                pool.submit(submitted++);
+            }
+            job& j = jobs[i];
+            {
+                std::unique_lock<std::mutex> lock(done_lock);
+                done.wait(lock, [&j] { return j.done; });
+            }
+            fwrite(j.output.data(), 1, j.output.size(), stdout);
+            if(!j.message.empty()) {
+                fflush(stdout);
+                fprintf(stderr, "%s\n", j.message.c_str());
+            }
+            if(!j.ok) {
+                result = 1;
+            }
+            totals.add(j.stats);
+            std::string().swap(j.output);
+        }
+    }
+    if(opts.cmd == command::stats && files.size() > 1) {
+        printf("total: %zu files, %llu bytes, %llu nodes, %llu objects, %llu arrays, %llu fields, %llu strings, %llu numbers, %llu booleans, %llu nulls, depth %zu\n",
+               files.size(), totals.bytes, totals.nodes, totals.objects, totals.arrays, totals.fields, totals.strings, totals.numbers, totals.booleans, totals.nulls, totals.max_level);
+    }
+    return result;
+}